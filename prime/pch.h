@@ -1,18 +1,51 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <numeric> // iota
+#include <random>
+#include <span>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <cctype>
 #include <iterator>
 #include <optional>
 
+#if defined(_MSC_VER)
+#  include <intrin.h> // _umul128
+#endif
+
+#if defined(_WIN32)
+#  define NOMINMAX
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h> // MapViewOfFile
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
 #include "fmt/core.h"
 #include "fmt/color.h"
+#include "fmt/format.h"
@@ -7,19 +7,80 @@
  * Anders Karlsson 2015-2017
  */
 
+class FactorCache;
+
 namespace
 {
   static bool trace = false;
+  static std::size_t sieveSegmentSize = 256 * 1024; // bytes, one per odd number
+  static std::chrono::milliseconds factorTimeLimit{0}; // per number, 0 == no limit
+  static std::chrono::seconds checkpointInterval{60};
+  static std::size_t memoryBudget = 0; // bytes, 0 == no limit
+  static long long tableLimit = 999'999; // largest number in the prime table
+  static unsigned threadLimit = 0; // 0 == one per hardware thread
+  static std::size_t batchChunk = 1 << 20; // numbers per --batch pass
+  static std::string sieveEngine; // --sieve=, empty to let selectSieveEngine() pick
+  static std::string sieveUsed; // what generatePrimes() ran, for --stats
+  static std::string factorCacheFile; // --cache, empty for none
+  static std::size_t factorCacheSize = 64 << 20; // bytes of a new --cache file
+  static FactorCache* factorCache = nullptr; // set by openFactorCache()
 }
 
 bool verifyFunctionality();
 
 std::vector<long long> generatePrimes();
+void tuneSieveEngines();
+void planMemory(std::size_t budget);
+std::shared_ptr<FactorCache> openFactorCache();
+void printStats(const std::vector<long long>& primes);
 std::pair<long long, long long>
-  decimalToFraction(const std::string& number, const std::vector<long long>& primes, const bool output = true);
+  decimalToFraction(const std::string& number, const bool output = true);
 std::map<long long, long long>
   factorizeNumber(const std::string& number, const std::vector<long long>& primes, const bool output = true);
+class BigInt;
+std::map<long long, long long> factorizeWideNumber(
+  const std::string& number,
+  const std::vector<long long>& primes,
+  const bool output = true,
+  BigInt* cofactor = nullptr);
+void batchGcd(const std::string& fileName);
+void batchSmoothness(const std::string& fileName, const std::vector<long long>& primes, long long bound);
+void batchFactorize(
+  const std::string& fileName,
+  const std::vector<long long>& primes,
+  bool dedup,
+  const std::string& outputFile);
+void printDoubleFraction(const std::string& number, long long limit);
+void batchDoubles(const std::string& fileName, long long limit);
+void batchAdjacentPrimes(const std::string& fileName, bool upwards, const std::vector<long long>& primes);
+void printAdjacentPrime(const std::string& number, bool upwards, const std::vector<long long>& primes);
+std::uint64_t primitiveRoot(std::uint64_t p, const std::vector<long long>& primes);
+std::uint64_t order(std::uint64_t a, std::uint64_t n, const std::vector<long long>& primes);
+void printPrimitiveRoots(std::uint64_t low, std::uint64_t high);
+void runAliquotSequences(
+  std::vector<std::uint64_t> starts,
+  std::size_t steps,
+  const std::string& logFile,
+  bool resume,
+  const std::vector<long long>& primes);
+std::uint64_t primeCount(std::uint64_t x, const std::string& checkpointFile, bool resume);
+void printPrimeSum(std::uint64_t x, unsigned k, std::uint64_t modulus);
+void sieveRange(
+  bool print,
+  std::uint64_t low,
+  std::uint64_t high,
+  std::pair<unsigned, unsigned> shard,
+  const std::string& outputFile,
+  const std::string& checkpointFile,
+  bool resume);
+void mergeShards(const std::vector<std::string>& fileNames);
+void exportPrimes(std::uint64_t low, std::uint64_t high, const std::string& fileName);
+void extractPrimes(const std::string& fileName, std::uint64_t low, std::uint64_t high);
+void factorizeFactorial(long long n, const std::vector<long long>& primes);
+void factorizeBinomial(long long n, long long k, const std::vector<long long>& primes);
+void runBenchmarks(const std::vector<long long>& primes);
 void printSyntax() noexcept;
+std::uint64_t parseUnsigned(const std::string& text, std::uint64_t limit = std::numeric_limits<std::uint64_t>::max());
 
 int main(int argc, char* argv[]) noexcept try
 {
@@ -30,6 +91,46 @@ int main(int argc, char* argv[]) noexcept try
   try
   {
     auto calculatePrimeNumber{false};
+    auto benchmark{false};
+    auto wideNumber{false}; // does not fit in a long long
+    std::string batchGcdFile;
+    std::string smoothFile;
+    std::string batchFile;
+    auto dedup{false};
+    auto rangeMode{0}; // 1 count, 2 list
+    std::uint64_t rangeLow{0};
+    std::uint64_t rangeHigh{0};
+    std::string checkpointFile;
+    auto resume{false};
+    std::pair<unsigned, unsigned> shard{1, 1}; // i/n
+    std::string outputFile;
+    std::vector<std::string> mergeFiles;
+    auto stats{false};
+    auto tune{false};
+    auto smoothBound{0ll}; // all table primes
+    auto factorialN{-1ll};
+    auto binomialK{-1ll}; // factorial when < 0
+    std::string doubleNumber;
+    std::string doublesFile;
+    auto fractionLimit{std::numeric_limits<long long>::max()};
+    auto primeStep{0}; // 1 --next, -1 --prev
+    std::uint64_t rootPrime{0};
+    std::pair<std::uint64_t, std::uint64_t> orderOf{0, 0}; // a mod n
+    std::pair<std::uint64_t, std::uint64_t> rootsRange{0, 0};
+    auto aliquot{false};
+    std::vector<std::uint64_t> aliquotStarts;
+    auto aliquotSteps{std::numeric_limits<std::size_t>::max()};
+    std::uint64_t piX{0};
+    auto piMode{false};
+    std::uint64_t sumX{0};
+    auto sumPower{1u};
+    std::uint64_t sumModulus{0}; // exact
+    auto sumMode{false};
+    std::pair<std::uint64_t, std::uint64_t> exportRange{0, 0};
+    auto exportMode{false};
+    std::string extractFile;
+    std::pair<std::uint64_t, std::uint64_t> extractRange{0, std::numeric_limits<std::uint64_t>::max()};
+    std::string primeFrom;
     if (argc == 1)
     {
       std::cout << "Enter an integer number to factorize into prime numbers:" << std::flush;
@@ -47,6 +148,15 @@ int main(int argc, char* argv[]) noexcept try
           {
             number = param;
           }
+          else if (
+            std::all_of(param.begin(), param.end(), [](unsigned char c) { return std::isdigit(c); })
+            && (param.length() > 19
+                || (param.length() == 19 && param > std::to_string(std::numeric_limits<long long>::max()))))
+          {
+            calculatePrimeNumber = true;
+            wideNumber = true;
+            number = param;
+          }
           else if (isdigit(static_cast<unsigned char>(param.at(0))) && stoll(param) != 0)
           {
             calculatePrimeNumber = true;
@@ -58,6 +168,224 @@ int main(int argc, char* argv[]) noexcept try
               return -2;
             }
           }
+          else if (param == "--bench")
+          {
+            benchmark = true;
+          }
+          else if (param == "--batchgcd" && argc > 1)
+          {
+            batchGcdFile = *++argv;
+            --argc;
+          }
+          else if (param == "--smooth" && argc > 1)
+          {
+            smoothFile = *++argv;
+            --argc;
+            if (argc > 1 && isdigit(static_cast<unsigned char>(argv[1][0])))
+            {
+              smoothBound = std::stoll(*++argv);
+              --argc;
+            }
+          }
+          else if (param == "--batch" && argc > 1)
+          {
+            batchFile = *++argv;
+            --argc;
+          }
+          else if (param == "--dedup")
+          {
+            dedup = true;
+          }
+          else if ((param == "--count" || param == "--range") && argc > 2)
+          {
+            rangeMode = (param == "--count") ? 1 : 2;
+            rangeLow = parseUnsigned(*++argv);
+            rangeHigh = parseUnsigned(*++argv);
+            argc -= 2;
+          }
+          else if (param == "--checkpoint" && argc > 1)
+          {
+            checkpointFile = *++argv;
+            --argc;
+          }
+          else if (param == "--resume")
+          {
+            resume = true;
+          }
+          else if (param == "--shard" && argc > 1)
+          {
+            const std::string value{*++argv};
+            --argc;
+            const auto slash = value.find('/');
+            if (slash == std::string::npos)
+            {
+              throw std::invalid_argument("--shard needs i/n");
+            }
+            shard = {
+              static_cast<unsigned>(parseUnsigned(value.substr(0, slash), std::numeric_limits<unsigned>::max())),
+              static_cast<unsigned>(parseUnsigned(value.substr(slash + 1), std::numeric_limits<unsigned>::max()))};
+            if (shard.first < 1 || shard.first > shard.second)
+            {
+              throw std::invalid_argument("--shard needs 1 <= i <= n");
+            }
+          }
+          else if (param == "--output" && argc > 1)
+          {
+            outputFile = *++argv;
+            --argc;
+          }
+          else if (param == "--merge")
+          {
+            while (argc > 1 && argv[1][0] != '-')
+            {
+              mergeFiles.emplace_back(*++argv);
+              --argc;
+            }
+            if (mergeFiles.empty())
+            {
+              throw std::invalid_argument("--merge needs the shard files");
+            }
+          }
+          else if (param == "--max-memory" && argc > 1)
+          {
+            planMemory(static_cast<std::size_t>(parseUnsigned(*++argv, std::numeric_limits<std::size_t>::max() >> 20)) << 20);
+            --argc;
+          }
+          else if (param.rfind("--sieve=", 0) == 0)
+          {
+            sieveEngine = param.substr(8);
+          }
+          else if (param == "--tune")
+          {
+            tune = true;
+          }
+          else if (param == "--stats")
+          {
+            stats = true;
+          }
+          else if (param == "--cache" && argc > 1)
+          {
+            factorCacheFile = *++argv;
+            --argc;
+            if (argc > 1 && isdigit(static_cast<unsigned char>(argv[1][0])))
+            {
+              factorCacheSize = static_cast<std::size_t>(parseUnsigned(*++argv, std::numeric_limits<std::size_t>::max() >> 20)) << 20;
+              --argc;
+            }
+          }
+          else if (param == "--budget" && argc > 1)
+          {
+            factorTimeLimit = std::chrono::milliseconds(std::stoll(*++argv));
+            --argc;
+          }
+          else if (param == "--factorial" && argc > 1)
+          {
+            factorialN = std::stoll(*++argv);
+            --argc;
+          }
+          else if (param == "--binomial" && argc > 2)
+          {
+            factorialN = std::stoll(*++argv);
+            binomialK = std::stoll(*++argv);
+            argc -= 2;
+            if (factorialN < 0 || binomialK < 0 || binomialK > factorialN)
+            {
+              throw std::invalid_argument("0 <= k <= n for --binomial n k");
+            }
+          }
+          else if ((param == "--double" || param == "--doubles") && argc > 1)
+          {
+            (param == "--double" ? doubleNumber : doublesFile) = *++argv;
+            --argc;
+            if (argc > 1 && isdigit(static_cast<unsigned char>(argv[1][0])))
+            {
+              fractionLimit = std::stoll(*++argv);
+              --argc;
+              if (fractionLimit < 1)
+              {
+                throw std::invalid_argument("the fraction limit must be at least 1");
+              }
+            }
+          }
+          else if (param == "--next" || param == "--prev")
+          {
+            primeStep = (param == "--next") ? 1 : -1;
+            if (argc > 1 && isdigit(static_cast<unsigned char>(argv[1][0])))
+            {
+              primeFrom = *++argv;
+              --argc;
+            }
+          }
+          else if (param == "--root" && argc > 1)
+          {
+            rootPrime = parseUnsigned(*++argv);
+            --argc;
+          }
+          else if ((param == "--order" || param == "--roots") && argc > 2)
+          {
+            auto& pair = (param == "--order") ? orderOf : rootsRange;
+            pair.first = parseUnsigned(*++argv);
+            pair.second = parseUnsigned(*++argv);
+            argc -= 2;
+          }
+          else if (param == "--aliquot")
+          {
+            aliquot = true;
+            while (argc > 1 && isdigit(static_cast<unsigned char>(argv[1][0])))
+            {
+              aliquotStarts.push_back(parseUnsigned(*++argv));
+              --argc;
+            }
+          }
+          else if (param == "--pi" && argc > 1)
+          {
+            piMode = true;
+            piX = parseUnsigned(*++argv);
+            --argc;
+          }
+          else if (param == "--primesum" && argc > 1)
+          {
+            sumMode = true;
+            sumX = parseUnsigned(*++argv);
+            --argc;
+            if (argc > 1 && isdigit(static_cast<unsigned char>(argv[1][0])))
+            {
+              sumPower = static_cast<unsigned>(parseUnsigned(*++argv, std::numeric_limits<unsigned>::max()));
+              --argc;
+            }
+          }
+          else if (param == "--mod" && argc > 1)
+          {
+            sumModulus = parseUnsigned(*++argv);
+            --argc;
+            if (sumModulus == 0)
+            {
+              throw std::invalid_argument("please specify a modulus >= 1");
+            }
+          }
+          else if (param == "--export" && argc > 2)
+          {
+            exportMode = true;
+            exportRange.first = parseUnsigned(*++argv);
+            exportRange.second = parseUnsigned(*++argv);
+            argc -= 2;
+          }
+          else if (param == "--extract" && argc > 1)
+          {
+            extractFile = *++argv;
+            --argc;
+            if (argc > 2 && isdigit(static_cast<unsigned char>(argv[1][0])))
+            {
+              extractRange.first = parseUnsigned(*++argv);
+              extractRange.second = parseUnsigned(*++argv);
+              argc -= 2;
+            }
+          }
+          else if (param == "--steps" && argc > 1)
+          {
+            aliquotSteps = static_cast<std::size_t>(parseUnsigned(*++argv, std::numeric_limits<std::size_t>::max()));
+            --argc;
+          }
           else if (param.at(0) == '-' && param.length() > 1)
           {
             trace = (std::tolower(param.at(1)) == 't' || std::tolower(param.at(1)) == 'v');
@@ -72,12 +400,141 @@ int main(int argc, char* argv[]) noexcept try
       }
     }
 
+    const auto cache = openFactorCache();
+
+    if (!batchGcdFile.empty())
+    {
+      batchGcd(batchGcdFile);
+      return 0;
+    }
+
+    if (resume && checkpointFile.empty())
+    {
+      throw std::invalid_argument("--resume needs --checkpoint {file}");
+    }
+    if (stats && (rangeMode != 0 || !mergeFiles.empty()))
+    {
+      printStats({});
+    }
+    if (rootsRange.second != 0)
+    {
+      printPrimitiveRoots(rootsRange.first, rootsRange.second);
+      return 0;
+    }
+    if (piMode)
+    {
+      std::cout << primeCount(piX, checkpointFile, resume) << std::endl;
+      return 0;
+    }
+    if (sumMode)
+    {
+      printPrimeSum(sumX, sumPower, sumModulus);
+      return 0;
+    }
+    if (exportMode)
+    {
+      exportPrimes(exportRange.first, exportRange.second, outputFile);
+      return 0;
+    }
+    if (!extractFile.empty())
+    {
+      extractPrimes(extractFile, extractRange.first, extractRange.second);
+      return 0;
+    }
+    if (rangeMode != 0)
+    {
+      sieveRange(rangeMode == 2, rangeLow, rangeHigh, shard, outputFile, checkpointFile, resume);
+      return 0;
+    }
+    if (!mergeFiles.empty())
+    {
+      mergeShards(mergeFiles);
+      return 0;
+    }
+
+    if (tune)
+    {
+      tuneSieveEngines();
+      return 0;
+    }
+
+    if (!doubleNumber.empty())
+    {
+      printDoubleFraction(doubleNumber, fractionLimit);
+      return 0;
+    }
+    if (!doublesFile.empty())
+    {
+      batchDoubles(doublesFile, fractionLimit);
+      return 0;
+    }
+
+    // from decimal to fraction e.g. 2.25 => 2 1/4, no prime table needed
+    if (!calculatePrimeNumber && !benchmark && smoothFile.empty() && batchFile.empty() && factorialN < 0
+        && primeStep == 0 && rootPrime == 0 && orderOf.second == 0 && rootsRange.second == 0 && !aliquot)
+    {
+      decimalToFraction(number);
+      return 0;
+    }
+
     // generate some primes using Eratosthenes method
     const auto primes = generatePrimes();
+    if (stats)
+    {
+      printStats(primes);
+    }
 
-    if (!calculatePrimeNumber) // from decimal to fraction e.g. 2.25 => 2 1/4
+    if (benchmark)
+    {
+      runBenchmarks(primes);
+    }
+    else if (!smoothFile.empty())
+    {
+      batchSmoothness(smoothFile, primes, smoothBound);
+    }
+    else if (!batchFile.empty() && primeStep != 0)
+    {
+      batchAdjacentPrimes(batchFile, primeStep > 0, primes);
+    }
+    else if (!batchFile.empty())
+    {
+      batchFactorize(batchFile, primes, dedup, outputFile);
+    }
+    else if (aliquot)
+    {
+      if (aliquotStarts.empty() && !resume)
+      {
+        throw std::invalid_argument("--aliquot needs {n}... or --checkpoint {file} --resume");
+      }
+      runAliquotSequences(aliquotStarts, aliquotSteps, checkpointFile, resume, primes);
+    }
+    else if (rootPrime != 0)
+    {
+      std::cout << primitiveRoot(rootPrime, primes) << std::endl;
+    }
+    else if (orderOf.second != 0)
+    {
+      std::cout << order(orderOf.first, orderOf.second, primes) << std::endl;
+    }
+    else if (primeStep != 0)
+    {
+      if (primeFrom.empty())
+      {
+        throw std::invalid_argument("--next and --prev need {n} or --batch {file}");
+      }
+      printAdjacentPrime(primeFrom, primeStep > 0, primes);
+    }
+    else if (factorialN >= 0 && binomialK >= 0)
+    {
+      factorizeBinomial(factorialN, binomialK, primes);
+    }
+    else if (factorialN >= 0)
+    {
+      factorizeFactorial(factorialN, primes);
+    }
+    else if (wideNumber)
     {
-      decimalToFraction(number, primes);
+      [[maybe_unused]] auto m = factorizeWideNumber(number, primes);
     }
     else
     {
@@ -104,10 +561,59 @@ void printSyntax() noexcept try
   using std::cout;
   using std::endl;
 
-  cout << "Valid command line options are C>prime {n}|{x.y} [-t|-v]" << endl;
+  cout << "Valid command line options are C>prime {n}|{x.y} [-t|-v] [--budget ms] [--max-memory MB] [--stats]" << endl;
+  cout << "                                                      [--sieve={engine}] [--cache {file} [MB]]" << endl;
+  cout << "                            or C>prime --tune" << endl;
+  cout << "                            or C>prime --bench" << endl;
+  cout << "                            or C>prime --batchgcd {file}" << endl;
+  cout << "                            or C>prime --smooth {file} [B]" << endl;
+  cout << "                            or C>prime --batch {file} [--dedup|--next|--prev] [--output {file}]" << endl;
+  cout << "                            or C>prime --next|--prev {n}" << endl;
+  cout << "                            or C>prime --root {p}" << endl;
+  cout << "                            or C>prime --order {a} {n}" << endl;
+  cout << "                            or C>prime --roots {a} {b}" << endl;
+  cout << "                            or C>prime --aliquot {n}... [--steps {k}] [--checkpoint {file} [--resume]]" << endl;
+  cout << "                            or C>prime --pi {x} [--checkpoint {file} [--resume]]" << endl;
+  cout << "                            or C>prime --primesum {x} [k] [--mod {m}]" << endl;
+  cout << "                            or C>prime --count|--range {a} {b} [--shard {i/n}] [--output {file}]" << endl;
+  cout << "                                                             [--checkpoint {file} [--resume]]" << endl;
+  cout << "                            or C>prime --merge {file} {file}..." << endl;
+  cout << "                            or C>prime --export {a} {b} --output {file}" << endl;
+  cout << "                            or C>prime --extract {file} [a b]" << endl;
+  cout << "                            or C>prime --factorial {n}" << endl;
+  cout << "                            or C>prime --binomial {n} {k}" << endl;
+  cout << "                            or C>prime --double {x} [N]" << endl;
+  cout << "                            or C>prime --doubles {file} [N]" << endl;
   cout << "n   == integer != 0" << endl;
   cout << "x.y == double value != 0.0" << endl;
-  cout << "t   == trace" << endl << endl;
+  cout << "t   == trace" << endl;
+  cout << "--max-memory == fit the prime table, sieve segments, threads, batches and a new --cache in MB megabytes" << endl;
+  cout << "--stats == show what --max-memory chose" << endl;
+  cout << "--sieve=classic|segmented|linear|atkin == how to generate the prime table, default from the --tune profile" << endl;
+  cout << "--tune == time the sieves on this machine and save the profile" << endl;
+  cout << "--cache == keep factorizations in file (MB megabytes, 64 by default) for later runs and other processes" << endl;
+  cout << "--budget == time limit for splitting large factors, what is left is shown as composite" << endl;
+  cout << "--bench == time the primality tests" << endl;
+  cout << "--batchgcd == find moduli in file (one per line) that share a factor" << endl;
+  cout << "--smooth == smooth part of each number in file over the primes <= B" << endl;
+  cout << "--batch == factorize each number in file (one per line), --dedup factorizes repeated ones once," << endl;
+  cout << "           --output writes the factors to an Arrow IPC file instead" << endl;
+  cout << "--next, --prev == the prime after or before n, or each number of the --batch file" << endl;
+  cout << "--root, --order == smallest primitive root of the prime p, multiplicative order of a mod n" << endl;
+  cout << "--roots == every prime in [a,b] with its smallest primitive root" << endl;
+  cout << "--aliquot == run the aliquot sequences n, s(n), s(s(n)), ... in parallel, up to k more steps each," << endl;
+  cout << "             every term is logged to the --checkpoint file and --resume continues them" << endl;
+  cout << "--pi == number of primes <= x without sieving up to x, --checkpoint and --resume as below" << endl;
+  cout << "--primesum == sum of p^k (k = 1 by default) over the primes p <= x, exact or modulo m" << endl;
+  cout << "--count, --range == number of primes in [a,b] or the primes themselves, --checkpoint saves" << endl;
+  cout << "                   the position every minute and --resume continues from it" << endl;
+  cout << "--shard == part i of n of the range, balanced by cost, --output writes it to a result file" << endl;
+  cout << "--merge == combine the result files of all shards of a job" << endl;
+  cout << "--export == write the primes in [a,b] to a compressed file with an index of its blocks" << endl;
+  cout << "--extract == the primes of an --export file, or only those in [a,b]" << endl;
+  cout << "--factorial, --binomial == prime factors of n! and C(n,k) = n!/(k!(n-k)!)" << endl;
+  cout << "--double == exact fraction of the double nearest to x, and the closest one with terms <= N" << endl;
+  cout << "--doubles == fraction of each double in a binary file, exact or the closest with terms <= N" << endl << endl;
   cout << "E.g." << endl;
   cout << "  C>prime 1234 will give 2*617 (prime numbers)" << endl;
   cout << "  C>prime 12.25 will give 12 1/4 (fractions)" << endl;
@@ -118,380 +624,7242 @@ catch(const std::exception& ex)
 }  
 
 /**
- * Good old Eratosthenes way of calculating prime numbers, the method can
- * briefly be described as having a 2-dimensional table of numbers e.g. N x N; 1
- * 2 3... x 1 2 3 ... then multiplying the numbers with one another -- any
- * number that is not a product, is a prime number (1 is excluded since it isn't a prime number)
- *
- * @sa Euclid's lemma: If a prime divides the product of ab of two integers a and b,
- * then p must divide at least of of those integers a and b
- *
- * Example: find all prime numbers 1-10
- *
- *  1 2 3 4 5 6 7 8 9
- * 1x x x x x x x x x
- * 2x 4 6 8 .........  eliminates 4,6,8      "..." indicates a product >10
- * 3x 6 9 ...          eliminates 9
- * 4x 8 ...
- * 5x ...
- * 6x ...
- * 7x ...
- * 8x ...
- * 9x ...
- *
- * So from the original numbers 1,2,3,4,5,6,7,8,9 we remove the calculated
- * 4,6,8,9 and then 1,2,3,5,7 are left.
+ * A command line value of 0..limit. Unlike std::stoull it takes no sign, which stoull would
+ * wrap, and nothing after the digits, so "-5" and "1e5" are errors rather than 2^64-5 and 1.
  */
-std::vector<long long> generatePrimes()
+std::uint64_t parseUnsigned(const std::string& text, std::uint64_t limit)
 {
-  const auto start = std::chrono::system_clock::now();
-  std::vector<long long> primes;
-  const auto primeCandidates = 999'999U;
-  std::vector<long long> candidates(primeCandidates);
-  std::iota(std::begin(candidates), std::end(candidates), 1ll); // vector with 1,2, ... primeCandidates
+  std::size_t end = 0;
+  const auto value = (!text.empty() && std::isdigit(static_cast<unsigned char>(text[0]))) ? std::stoull(text, &end) : 0;
+  if (end == 0 || end != text.size() || value > limit)
+  {
+    throw std::invalid_argument(fmt::format("of 0 to {}, not '{}'", limit, text));
+  }
+  return value;
+}
 
-  // use the correct type 
-  using sz = std::vector<long long>::size_type;
+std::uint64_t integerRoot(std::uint64_t n, unsigned k) noexcept;
+template <typename T>
+bool isPrime(T n) noexcept;
 
-  for ( sz i = 2ul; i < candidates.size(); ++i)
+/**
+ * The odd primes a segmented sieve crosses off with. For a window much narrower than
+ * sqrt(high) only the primes below 2^16 are kept, which leaves no composite below 2^32, and
+ * what survives above that is tested with isPrime(): near 2^64 a window of 10^5 then needs a
+ * few thousand tests instead of the 2 * 10^8 primes up to 2^32.
+ */
+struct SieveBase
+{
+  std::vector<std::uint32_t> primes;
+  bool test = false;
+};
+
+SieveBase sieveBase(std::uint64_t high, std::uint64_t width);
+
+/**
+ * Segmented sieve of Eratosthenes over [low, high), onPrime(p) is called for every prime in
+ * increasing order and onSegment(end) once all primes below 'end' have been reported. Only odd
+ * numbers are sieved and only the primes of 'base', with the next multiple of each, plus one
+ * segment of sieveSegmentSize bytes are kept in memory, so the limit is not bounded by RAM the
+ * way the classic table is. 'base' must be from sieveBase() for a 'high' at least as large and
+ * a width at least as large.
+ */
+template <typename OnPrime, typename OnSegment>
+void sievePrimes(
+  std::uint64_t low,
+  std::uint64_t high,
+  const SieveBase& base,
+  const OnPrime& onPrime,
+  const OnSegment& onSegment)
+{
+  if (low <= 2 && high > 2)
   {
-    for ( sz j = 2ul; j < candidates.size(); ++j)
+    onPrime(std::uint64_t{2});
+  }
+  low = std::max<std::uint64_t>(low, 3) | 1;
+  if (low >= high)
+  {
+    return;
+  }
+
+  // the first odd multiple of each base prime not yet crossed off
+  std::vector<std::uint64_t> next;
+  for (const std::uint64_t p : base.primes)
+  {
+    if (p * p >= high)
     {
-      if (i * j <= primeCandidates)
+      break;
+    }
+    // a multiple past 2^64 wraps below 'low' and is never reached
+    const auto start = std::max(p * p, low + (p - low % p) % p);
+    next.push_back(start % 2 == 0 ? start + p : start);
+  }
+
+  // composite[i] is the number lo + 2i, the last segment ends at 'high' without going past 2^64
+  std::vector<char> composite(sieveSegmentSize);
+  for (auto lo = low;; lo += 2 * sieveSegmentSize)
+  {
+    const auto hi = (high - lo > 2 * sieveSegmentSize) ? lo + 2 * sieveSegmentSize : high;
+    const auto count = static_cast<std::size_t>((hi - lo + 1) / 2);
+    std::fill_n(composite.begin(), count, 0);
+
+    for (std::size_t k = 0; k < next.size() && std::uint64_t{base.primes[k]} * base.primes[k] < hi; ++k)
+    {
+      const std::uint64_t p = base.primes[k];
+      auto i = static_cast<std::size_t>((next[k] - lo) / 2);
+      for (; i < count; i += p)
       {
-        candidates.at(i * j - 1) = 0ll;
+        composite[i] = 1;
       }
-      else
+      next[k] = lo + 2 * i;
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      if (!composite[i] && (!base.test || lo + 2 * i < (std::uint64_t{1} << 32) || isPrime(lo + 2 * i)))
       {
-        break; // quit since all products after will be larger
+        onPrime(lo + 2 * i);
       }
     }
+    onSegment(hi);
+    if (hi == high)
+    {
+      break;
+    }
   }
+}
 
-  for (auto n : candidates)
+template <typename OnPrime, typename OnSegment>
+void sievePrimes(std::uint64_t low, std::uint64_t high, const OnPrime& onPrime, const OnSegment& onSegment)
+{
+  if (low < high)
   {
-    if (n > 1) // 1 not a prime number
+    sievePrimes(low, high, sieveBase(high, high - low), onPrime, onSegment);
+  }
+}
+
+template <typename OnPrime>
+void sievePrimes(std::uint64_t low, std::uint64_t high, const OnPrime& onPrime)
+{
+  sievePrimes(low, high, onPrime, [](std::uint64_t) {});
+}
+
+/**
+ * The base for windows of 'width' numbers below 'high'. Below 2^16 the primes come from a plain
+ * sieve, above it segment by segment with the primes up to their own square root.
+ */
+SieveBase sieveBase(std::uint64_t high, std::uint64_t width)
+{
+  constexpr std::uint64_t small = 1 << 16;
+  const auto root = (high > 1) ? integerRoot(high - 1, 2) : 0;
+  SieveBase base{.primes = {}, .test = root >= small && width < root / 8};
+  const auto limit = base.test ? small - 1 : root;
+  if (limit < small)
+  {
+    std::vector<char> composite(limit + 1, 0);
+    for (std::uint64_t i = 3; i <= limit; i += 2)
     {
-      primes.emplace_back(n);
+      if (!composite[i])
+      {
+        base.primes.push_back(static_cast<std::uint32_t>(i));
+        for (auto j = i * i; j <= limit; j += 2 * i)
+        {
+          composite[j] = 1;
+        }
+      }
     }
+    return base;
   }
 
-  if (trace)
+  base.primes.reserve(static_cast<std::size_t>(static_cast<double>(limit) / std::log(static_cast<double>(limit)) * 1.2));
+  sievePrimes(3, limit + 1, sieveBase(limit + 1, limit), [&](std::uint64_t p) {
+    base.primes.push_back(static_cast<std::uint32_t>(p));
+  }, [](std::uint64_t) {});
+  return base;
+}
+
+constexpr std::uint64_t atkinLimit = std::uint64_t{1} << 62;
+
+/**
+ * Segmented Sieve of Atkin over [low, high) with the same callbacks as sievePrimes(). A number
+ * n > 5 with no square factor is prime iff it has an odd number of solutions of the quadratic
+ * form its residue mod 60 belongs to, 4x^2+y^2, 3x^2+y^2 or 3x^2-y^2 (x > y). Each form keeps its
+ * next y for every x between segments, stepping y by 2 keeps n in the right class mod 12, and
+ * the table below picks the form from n mod 60. Squares of primes are crossed off afterwards.
+ * 3x^2 must not pass 2^64, so high is at most atkinLimit.
+ */
+template <typename OnPrime, typename OnSegment>
+void atkinPrimes(std::uint64_t low, std::uint64_t high, const OnPrime& onPrime, const OnSegment& onSegment)
+{
+  assert(high <= atkinLimit);
+  static constexpr std::uint8_t forms[60] = {
+    0, 1, 0, 0, 0, 0, 0, 2, 0, 0, 0, 3, 0, 1, 0, 0, 0, 1, 0, 2, 0, 0, 0, 3, 0, 0, 0, 0, 0, 1,
+    0, 2, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 2, 0, 0, 0, 3, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 3};
+
+  for (std::uint64_t p : {2, 3, 5})
   {
-    using namespace std::chrono;
-    const auto stop = system_clock::now();
+    if (p >= low && p < high)
+    {
+      onPrime(p);
+    }
+  }
+  low = std::max<std::uint64_t>(low, 7) | 1;
+  if (low >= high)
+  {
+    return;
+  }
 
-    std::cout << "Calculated " << primes.size() << " prime numbers using 'Sieve of Eratosthenes'"
-              << " which took " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count()
-              << " ms" << std::endl;
-    std::cout << "Last ten::";
-    for (auto it = primes.rbegin(); it != primes.rbegin() + 10; ++it)
+  const auto floorRoot = [](std::uint64_t n) {
+    auto root = static_cast<std::uint64_t>(std::sqrt(static_cast<double>(n)));
+    while (root * root > n)
+    {
+      --root;
+    }
+    while ((root + 1) * (root + 1) <= n)
+    {
+      ++root;
+    }
+    return root;
+  };
+  const auto ceilRoot = [&](std::uint64_t n) {
+    const auto root = floorRoot(n);
+    return (root * root < n) ? root + 1 : root;
+  };
+
+  // the first y of every x that reaches 'low', y odd for 4x^2+y^2, x odd and y even for
+  // 3x^2+y^2, x+y odd and y counting down from x-1 for 3x^2-y^2
+  std::vector<std::uint64_t> y1;
+  for (std::uint64_t x = 1; 4 * x * x + 1 < high; ++x)
+  {
+    const auto base = 4 * x * x;
+    const auto y = (base + 1 >= low) ? 1 : ceilRoot(low - base);
+    y1.push_back(y | 1);
+  }
+  std::vector<std::uint64_t> y2;
+  for (std::uint64_t x = 1; 3 * x * x + 4 < high; x += 2)
+  {
+    const auto base = 3 * x * x;
+    const auto y = (base + 4 >= low) ? 2 : ceilRoot(low - base);
+    y2.push_back(y + (y & 1));
+  }
+  std::vector<std::int64_t> y3;
+  for (std::uint64_t x = 1; 2 * x * x + 2 * x - 1 < high; ++x)
+  {
+    const auto base = 3 * x * x;
+    auto y = (base < low + 1) ? -1 : static_cast<std::int64_t>(std::min(x - 1, floorRoot(base - low)));
+    if (y >= 0 && (x + static_cast<std::uint64_t>(y)) % 2 == 0)
+    {
+      --y;
+    }
+    y3.push_back(y);
+  }
+
+  // squares of the primes up to sqrt(high) with their next odd multiple
+  std::vector<std::uint64_t> squares;
+  std::vector<std::uint64_t> next;
+  sievePrimes(7, floorRoot(high - 1) + 1, [&](std::uint64_t p) {
+    const auto square = p * p;
+    const auto start = (low + square - 1) / square * square;
+    squares.push_back(square);
+    next.push_back(start % 2 == 0 ? start + square : start);
+  });
+
+  // candidate[i] is the number lo + 2i, set for an odd number of solutions
+  std::vector<char> candidate(sieveSegmentSize);
+  std::size_t first3 = 0; // y3 below it are used up
+  for (auto lo = low; lo < high; lo += 2 * sieveSegmentSize)
+  {
+    const auto hi = std::min(high, lo + 2 * sieveSegmentSize);
+    const auto count = static_cast<std::size_t>((hi - lo + 1) / 2);
+    std::fill_n(candidate.begin(), count, 0);
+    const auto toggle = [&](std::uint64_t n, std::uint8_t form) {
+      if (forms[n % 60] == form)
+      {
+        candidate[static_cast<std::size_t>((n - lo) / 2)] ^= 1;
+      }
+    };
+
+    for (std::size_t i = 0; i < y1.size(); ++i)
+    {
+      const std::uint64_t x = i + 1;
+      const auto base = 4 * x * x;
+      if (base + 1 >= hi)
+      {
+        break;
+      }
+      auto y = y1[i];
+      for (; base + y * y < hi; y += 2)
+      {
+        toggle(base + y * y, 1);
+      }
+      y1[i] = y;
+    }
+    for (std::size_t i = 0; i < y2.size(); ++i)
+    {
+      const std::uint64_t x = 2 * i + 1;
+      const auto base = 3 * x * x;
+      if (base + 4 >= hi)
+      {
+        break;
+      }
+      auto y = y2[i];
+      for (; base + y * y < hi; y += 2)
+      {
+        toggle(base + y * y, 2);
+      }
+      y2[i] = y;
+    }
+    while (first3 < y3.size() && y3[first3] < 1)
+    {
+      ++first3;
+    }
+    for (auto i = first3; i < y3.size(); ++i)
+    {
+      const std::uint64_t x = i + 1;
+      const auto base = 3 * x * x;
+      if (base - (x - 1) * (x - 1) >= hi)
+      {
+        break;
+      }
+      auto y = y3[i];
+      for (; y >= 1 && base - static_cast<std::uint64_t>(y * y) < hi; y -= 2)
+      {
+        toggle(base - static_cast<std::uint64_t>(y * y), 3);
+      }
+      y3[i] = y;
+    }
+
+    for (std::size_t k = 0; k < squares.size() && squares[k] < hi; ++k)
+    {
+      auto i = static_cast<std::size_t>((next[k] - lo) / 2);
+      for (; i < count; i += squares[k])
+      {
+        candidate[i] = 0;
+      }
+      next[k] = lo + 2 * i;
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      if (candidate[i])
+      {
+        onPrime(lo + 2 * i);
+      }
+    }
+    onSegment(hi);
+  }
+}
+
+/**
+ * Every prime up to and including 'limit', from the table as far as it goes and from the
+ * segmented sieve after that.
+ */
+template <typename OnPrime>
+void forEachPrime(std::uint64_t limit, const std::vector<long long>& primes, const OnPrime& onPrime)
+{
+  for (auto p : primes)
+  {
+    if (static_cast<std::uint64_t>(p) > limit)
+    {
+      return;
+    }
+    onPrime(static_cast<std::uint64_t>(p));
+  }
+  sievePrimes(static_cast<std::uint64_t>(primes.back()) + 1, limit + 1, onPrime);
+}
+
+/**
+ * Fit the prime table, the sieve segment, the number of threads and the batch chunk into
+ * 'budget' bytes (0 for no limit). The classic candidate table alone is 8 MB, below 16 MB
+ * selectSieveEngine() passes it over, and below 4 MB the table is also cut to what fits in an
+ * eighth of the budget.
+ */
+void planMemory(std::size_t budget)
+{
+  memoryBudget = budget;
+  if (budget == 0)
+  {
+    return;
+  }
+
+  for (tableLimit = 999'999; tableLimit > 1000; tableLimit /= 2)
+  {
+    const auto tableBytes = static_cast<double>(tableLimit) / std::log(static_cast<double>(tableLimit)) * 1.2
+                            * sizeof(long long);
+    if (tableBytes <= static_cast<double>(budget) / 8)
+    {
+      break;
+    }
+  }
+
+  sieveSegmentSize = std::clamp<std::size_t>(std::bit_floor(budget / 8), 4 * 1024, 256 * 1024);
+  threadLimit = static_cast<unsigned>(std::clamp<std::size_t>(budget / (32 << 20), 1, std::max(1u, std::thread::hardware_concurrency())));
+  batchChunk = std::clamp<std::size_t>(budget / 4 / 512, 256, 1 << 20); // about 512 bytes a number with its factors
+}
+
+/**
+ * Fail early when a job would need more than the memory budget.
+ */
+void checkMemory(double bytes, const char* what)
+{
+  if (memoryBudget != 0 && bytes > static_cast<double>(memoryBudget))
+  {
+    throw std::runtime_error(
+      fmt::format("{} needs about {} KB, more than --max-memory", what, static_cast<std::uint64_t>(bytes / 1024)));
+  }
+}
+
+/**
+ * What planMemory() chose, for --stats.
+ */
+void printStats(const std::vector<long long>& primes)
+{
+  std::cout << "memory budget   " << (memoryBudget == 0 ? std::string("none") : std::to_string(memoryBudget >> 10) + " KB")
+            << std::endl;
+  if (primes.empty())
+  {
+    std::cout << "prime table     not used" << std::endl;
+  }
+  else
+  {
+    std::cout << "prime table     " << primes.size() << " primes <= " << primes.back() << ", "
+              << (primes.capacity() * sizeof(long long) >> 10) << " KB, " << sieveUsed << " sieve" << std::endl;
+  }
+  std::cout << "sieve segment   " << (sieveSegmentSize >> 10) << " KB" << std::endl;
+  std::cout << "threads         " << (threadLimit == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threadLimit)
+            << std::endl;
+  std::cout << "batch chunk     " << batchChunk << " numbers" << std::endl;
+  if (factorCacheFile.empty())
+  {
+    std::cout << "factor cache    not used" << std::endl;
+  }
+  else
+  {
+    std::error_code missing;
+    const auto bytes = std::filesystem::file_size(factorCacheFile, missing);
+    std::cout << "factor cache    " << ((missing ? factorCacheSize : bytes) >> 10) << " KB" << std::endl;
+  }
+}
+
+/**
+ * Good old Eratosthenes way of calculating prime numbers, the method can
+ * briefly be described as having a 2-dimensional table of numbers e.g. N x N; 1
+ * 2 3... x 1 2 3 ... then multiplying the numbers with one another -- any
+ * number that is not a product, is a prime number (1 is excluded since it isn't a prime number)
+ *
+ * @sa Euclid's lemma: If a prime divides the product of ab of two integers a and b,
+ * then p must divide at least of of those integers a and b
+ *
+ * Example: find all prime numbers 1-10
+ *
+ *  1 2 3 4 5 6 7 8 9
+ * 1x x x x x x x x x
+ * 2x 4 6 8 .........  eliminates 4,6,8      "..." indicates a product >10
+ * 3x 6 9 ...          eliminates 9
+ * 4x 8 ...
+ * 5x ...
+ * 6x ...
+ * 7x ...
+ * 8x ...
+ * 9x ...
+ *
+ * So from the original numbers 1,2,3,4,5,6,7,8,9 we remove the calculated
+ * 4,6,8,9 and then 1,2,3,5,7 are left.
+ */
+std::vector<long long> classicSieve(long long limit)
+{
+  std::vector<long long> primes;
+  const auto primeCandidates = static_cast<std::size_t>(limit);
+  std::vector<long long> candidates(primeCandidates);
+  std::iota(std::begin(candidates), std::end(candidates), 1ll); // vector with 1,2, ... primeCandidates
+
+  // use the correct type 
+  using sz = std::vector<long long>::size_type;
+
+  for ( sz i = 2ul; i < candidates.size(); ++i)
+  {
+    for ( sz j = 2ul; j < candidates.size(); ++j)
+    {
+      if (i * j <= primeCandidates)
+      {
+        candidates.at(i * j - 1) = 0ll;
+      }
+      else
+      {
+        break; // quit since all products after will be larger
+      }
+    }
+  }
+
+  for (auto n : candidates)
+  {
+    if (n > 1) // 1 not a prime number
+    {
+      primes.emplace_back(n);
+    }
+  }
+  return primes;
+}
+
+/**
+ * The segmented sieve, only a segment and the primes up to sqrt(limit) besides the table.
+ */
+std::vector<long long> segmentedSieve(long long limit)
+{
+  std::vector<long long> primes;
+  sievePrimes(2, static_cast<std::uint64_t>(limit) + 1, [&](std::uint64_t p) {
+    primes.push_back(static_cast<long long>(p));
+  });
+  primes.shrink_to_fit();
+  return primes;
+}
+
+/**
+ * The segmented Sieve of Atkin, for comparison with the segmented Sieve of Eratosthenes.
+ */
+std::vector<long long> atkinSieve(long long limit)
+{
+  std::vector<long long> primes;
+  atkinPrimes(
+    2,
+    static_cast<std::uint64_t>(limit) + 1,
+    [&](std::uint64_t p) { primes.push_back(static_cast<long long>(p)); },
+    [](std::uint64_t) {});
+  primes.shrink_to_fit();
+  return primes;
+}
+
+/**
+ * Euler's linear sieve, every composite is crossed off exactly once, by its smallest prime
+ * factor which is kept for every number.
+ */
+std::vector<long long> linearSieve(long long limit)
+{
+  std::vector<long long> primes;
+  std::vector<std::uint32_t> smallestFactor(static_cast<std::size_t>(limit) + 1, 0);
+  for (std::uint32_t i = 2; i <= limit; ++i)
+  {
+    if (smallestFactor[i] == 0)
+    {
+      smallestFactor[i] = i;
+      primes.push_back(i);
+    }
+    for (auto p : primes)
+    {
+      if (p > smallestFactor[i] || p * i > limit)
+      {
+        break;
+      }
+      smallestFactor[static_cast<std::size_t>(p * i)] = static_cast<std::uint32_t>(p);
+    }
+  }
+  return primes;
+}
+
+/**
+ * A way of generating the prime table, 'bytes' is about what it needs per number up to the limit.
+ */
+struct SieveEngine
+{
+  const char* name;
+  const char* description;
+  double bytes;
+  std::vector<long long> (*generate)(long long limit);
+};
+
+const std::vector<SieveEngine>& sieveEngines()
+{
+  static const std::vector<SieveEngine> engines{
+    {"classic", "Sieve of Eratosthenes", 8, classicSieve},
+    {"segmented", "segmented Sieve of Eratosthenes", 0, segmentedSieve},
+    {"linear", "linear sieve", 4, linearSieve},
+    {"atkin", "segmented Sieve of Atkin", 0, atkinSieve},
+  };
+  return engines;
+}
+
+/**
+ * Where --tune keeps the timings of this machine.
+ */
+std::filesystem::path profilePath()
+{
+  for (const auto* variable : {"PRIME_PROFILE", "HOME", "USERPROFILE"})
+  {
+    if (const auto* value = std::getenv(variable); value != nullptr && *value != '\0')
+    {
+      return (variable == std::string("PRIME_PROFILE")) ? std::filesystem::path(value)
+                                                        : std::filesystem::path(value) / ".prime_profile";
+    }
+  }
+  return ".prime_profile";
+}
+
+/**
+ * The engine for a table up to 'limit': the one given with --sieve, else the fastest one in the
+ * --tune profile at the profiled limit nearest to 'limit', else the classic one. Engines that
+ * would not fit in the memory budget are passed over.
+ */
+const SieveEngine& selectSieveEngine(long long limit)
+{
+  const auto& engines = sieveEngines();
+  const auto fits = [&](const SieveEngine& engine) {
+    return memoryBudget == 0 || engine.bytes * static_cast<double>(limit) <= static_cast<double>(memoryBudget) / 2;
+  };
+
+  if (!sieveEngine.empty())
+  {
+    const auto it = std::find_if(engines.begin(), engines.end(), [](const SieveEngine& engine) {
+      return engine.name == sieveEngine;
+    });
+    if (it == engines.end())
+    {
+      std::string names;
+      for (const auto& engine : engines)
+      {
+        names += std::string(" ") + engine.name;
+      }
+      throw std::invalid_argument("unknown sieve '" + sieveEngine + "', use one of" + names);
+    }
+    checkMemory(it->bytes * static_cast<double>(limit), it->name);
+    return *it;
+  }
+
+  // lines of "limit engine nanoseconds"
+  std::ifstream in(profilePath());
+  std::string header;
+  if (std::getline(in, header) && header == "prime profile 1")
+  {
+    const SieveEngine* best = nullptr;
+    auto bestDistance = std::numeric_limits<double>::max();
+    auto bestTime = std::numeric_limits<double>::max();
+    std::string name;
+    double profiled;
+    double time;
+    while (in >> profiled >> name >> time)
+    {
+      const auto it = std::find_if(engines.begin(), engines.end(), [&](const SieveEngine& engine) {
+        return engine.name == name;
+      });
+      const auto distance = std::abs(std::log(profiled) - std::log(static_cast<double>(limit)));
+      if (it == engines.end() || !fits(*it) || distance > bestDistance + 1e-9
+          || (distance > bestDistance - 1e-9 && time >= bestTime))
+      {
+        continue;
+      }
+      best = &*it;
+      bestDistance = distance;
+      bestTime = time;
+    }
+    if (best != nullptr)
+    {
+      return *best;
+    }
+  }
+  return fits(engines.front()) ? engines.front() : engines[1];
+}
+
+/**
+ * The prime table up to tableLimit from the engine selectSieveEngine() picks.
+ */
+std::vector<long long> generatePrimes()
+{
+  const auto start = std::chrono::system_clock::now();
+  const auto& engine = selectSieveEngine(tableLimit);
+  sieveUsed = engine.name;
+  const auto primes = engine.generate(tableLimit);
+
+  if (trace)
+  {
+    using namespace std::chrono;
+    const auto stop = system_clock::now();
+
+    std::cout << "Calculated " << primes.size() << " prime numbers using '" << engine.description << "'"
+              << " which took " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count()
+              << " ms" << std::endl;
+    std::cout << "Last ten::";
+    for (auto it = primes.rbegin(); it != primes.rbegin() + 10; ++it)
+    {
+      std::cout << *it << " ";
+    }
+    std::cout << std::endl;
+  }
+
+  return primes;
+}
+
+/**
+ * Time every engine at a few limits, best of three, and save the timings as the profile that
+ * selectSieveEngine() uses from then on.
+ */
+void tuneSieveEngines()
+{
+  using namespace std::chrono;
+
+  std::ostringstream profile;
+  profile << "prime profile 1\n";
+  for (long long limit : {100'000ll, 1'000'000ll, 10'000'000ll})
+  {
+    for (const auto& engine : sieveEngines())
+    {
+      if (memoryBudget != 0 && engine.bytes * static_cast<double>(limit) > static_cast<double>(memoryBudget) / 2)
+      {
+        continue;
+      }
+      auto best = std::numeric_limits<double>::max();
+      for (int run = 0; run < 3; ++run)
+      {
+        const auto start = steady_clock::now();
+        [[maybe_unused]] const auto primes = engine.generate(limit);
+        best = std::min(best, static_cast<double>(duration_cast<nanoseconds>(steady_clock::now() - start).count()));
+      }
+      fmt::print("{:>10} {:<12} {:10.3f} ms\n", limit, engine.name, best / 1e6);
+      profile << limit << ' ' << engine.name << ' ' << best << '\n';
+    }
+  }
+
+  const auto path = profilePath();
+  std::ofstream out(path, std::ios::trunc);
+  if (!(out << profile.str()))
+  {
+    throw std::runtime_error("cannot write '" + path.string() + "'");
+  }
+  std::cout << "profile saved to " << path.string() << std::endl;
+}
+
+//////////////////////////////////////////////////////////////////
+// primality
+//////////////////////////////////////////////////////////////////
+
+/**
+ * Full product of two 32-bit resp. 64-bit numbers, the low half is returned and the high half
+ * is stored in 'hi'.
+ */
+inline std::uint32_t wideMultiply(std::uint32_t a, std::uint32_t b, std::uint32_t& hi) noexcept
+{
+  const auto p = static_cast<std::uint64_t>(a) * b;
+  hi = static_cast<std::uint32_t>(p >> 32);
+  return static_cast<std::uint32_t>(p);
+}
+
+inline std::uint64_t wideMultiply(std::uint64_t a, std::uint64_t b, std::uint64_t& hi) noexcept
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+  return _umul128(a, b, &hi);
+#elif defined(__SIZEOF_INT128__)
+  const auto p = static_cast<unsigned __int128>(a) * b;
+  hi = static_cast<std::uint64_t>(p >> 64);
+  return static_cast<std::uint64_t>(p);
+#else
+  // schoolbook on 32-bit halves for 32-bit targets
+  const std::uint64_t aLo = a & 0xffffffffu, aHi = a >> 32;
+  const std::uint64_t bLo = b & 0xffffffffu, bHi = b >> 32;
+  const auto lolo = aLo * bLo;
+  const auto hilo = aHi * bLo;
+  const auto lohi = aLo * bHi;
+  const auto mid = (lolo >> 32) + (hilo & 0xffffffffu) + lohi;
+  hi = aHi * bHi + (hilo >> 32) + (mid >> 32);
+  return (mid << 32) | (lolo & 0xffffffffu);
+#endif
+}
+
+/**
+ * Montgomery arithmetic modulo an odd number n. Numbers are kept as a*R mod n where
+ * R = 2^32 or 2^64 depending on T, which replaces the division in a*b mod n with two
+ * multiplications. T is std::uint32_t or std::uint64_t.
+ */
+template <typename T>
+class Montgomery
+{
+public:
+  explicit Montgomery(T n) noexcept
+    : n_(n)
+  {
+    assert(n % 2 == 1);
+
+    // Newton iteration for n^-1 mod R, every step doubles the number of correct bits
+    inverse_ = n;
+    for (int i = 0; i < 5; ++i)
+    {
+      inverse_ *= 2 - n * inverse_;
+    }
+
+    // R mod n, then R^2 mod n by doubling it another 'bits' times
+    one_ = static_cast<T>(T(0) - n) % n;
+    r2_ = one_;
+    for (int i = 0; i < std::numeric_limits<T>::digits; ++i)
+    {
+      r2_ = add(r2_, r2_);
+    }
+  }
+
+  T modulus() const noexcept
+  {
+    return n_;
+  }
+
+  T one() const noexcept
+  {
+    return one_;
+  }
+
+  T toMontgomery(T a) const noexcept
+  {
+    return multiply(a % n_, r2_);
+  }
+
+  T fromMontgomery(T a) const noexcept
+  {
+    return reduce(a, 0);
+  }
+
+  T add(T a, T b) const noexcept
+  {
+    return (a >= n_ - b) ? a - (n_ - b) : a + b;
+  }
+
+  T subtract(T a, T b) const noexcept
+  {
+    return (a >= b) ? a - b : a + (n_ - b);
+  }
+
+  T multiply(T a, T b) const noexcept
+  {
+    T hi;
+    const auto lo = wideMultiply(a, b, hi);
+    return reduce(lo, hi);
+  }
+
+  T power(T base, T exponent) const noexcept
+  {
+    auto result = one_;
+    while (exponent != 0)
+    {
+      if (exponent & 1)
+      {
+        result = multiply(result, base);
+      }
+      base = multiply(base, base);
+      exponent >>= 1;
+    }
+    return result;
+  }
+
+private:
+  // (hi:lo) / R mod n, lo - m*n is 0 mod R so only the high halves have to be subtracted
+  T reduce(T lo, T hi) const noexcept
+  {
+    const T m = lo * inverse_;
+    T mnHi;
+    wideMultiply(m, n_, mnHi);
+    return (hi >= mnHi) ? hi - mnHi : hi + (n_ - mnHi);
+  }
+
+  T n_;
+  T inverse_;
+  T one_;
+  T r2_;
+};
+
+/**
+ * Number of trailing zero bits, overloaded for BigInt.
+ */
+template <typename T>
+int trailingZeros(T value) noexcept
+{
+  return std::countr_zero(value);
+}
+
+/**
+ * Miller-Rabin strong probable prime test of an odd n > 2 to the given base, one modular
+ * exponentiation plus at most s-1 squarings where n-1 = d*2^s. Mont is Montgomery<T> or
+ * BigMontgomery and V the matching value type.
+ */
+template <typename Mont, typename V>
+bool isStrongProbablePrime(const Mont& mont, const V& base)
+{
+  const V n = mont.modulus();
+  V d = n - 1;
+  const auto s = trailingZeros(d);
+  d >>= s;
+
+  const auto a = mont.toMontgomery(base);
+  if (a == V{})
+  {
+    return false; // n divides the base, the hashed 32-bit table relies on this being rejected
+  }
+
+  const auto minusOne = n - mont.one();
+  auto x = mont.power(a, d);
+  if (x == mont.one() || x == minusOne)
+  {
+    return true;
+  }
+  for (int i = 1; i < s; ++i)
+  {
+    x = mont.multiply(x, x);
+    if (x == minusOne)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Deterministic primality test, the variant is selected at compile time by the width of T.
+ *
+ * 32-bit: hashed single base (Forisek & Jancina), n is hashed into one of 4096 buckets and each
+ * bucket has its own base that no odd composite < 2^32 in that bucket passes, so one Miller-Rabin
+ * round decides. The table was found by exhaustive search over all 32-bit odd numbers not
+ * divisible by 3, 5 or 7.
+ *
+ * 64-bit: numbers that fit in 32 bits take the path above, the rest use the seven bases found
+ * by Jim Sinclair which are known to be sufficient for all n < 2^64.
+ */
+template <typename T>
+bool isPrime(T n) noexcept
+{
+  static_assert(std::is_unsigned_v<T>, "isPrime needs an unsigned type");
+
+  if constexpr (std::numeric_limits<T>::digits <= 32)
+  {
+    static constexpr std::uint16_t bases[4096] = {
+      10478, 7357, 46314, 41728, 20266, 50939, 57012, 41604, 41173, 43453, 34080, 64061,
+      64199, 30499, 43309, 36624, 13115, 23741, 9004, 6843, 12379, 24062, 23755, 51563,
+      3017, 24687, 26544, 39323, 27628, 28258, 41631, 43042, 6039, 11870, 21694, 52102,
+      42093, 22530, 36804, 53933, 23827, 42112, 4673, 16888, 46356, 25909, 58667, 23097,
+      16701, 7303, 50542, 53614, 64905, 51516, 14160, 12864, 18304, 61316, 42367, 6876,
+      64212, 41143, 6646, 61742, 28794, 34333, 6476, 59716, 28311, 57342, 4664, 7493,
+      27238, 8281, 20539, 58954, 26971, 16506, 63669, 53009, 27053, 51926, 64133, 38019,
+      10918, 13994, 36062, 30377, 40192, 27899, 2511, 65108, 45145, 4768, 29832, 60222,
+      61193, 55315, 16857, 54578, 31210, 59133, 43062, 37261, 44984, 47100, 43261, 46560,
+      14631, 29885, 27226, 60201, 54362, 31578, 34212, 25124, 62056, 2526, 63597, 59835,
+      59787, 8724, 54545, 25058, 13928, 60047, 64873, 33106, 52204, 33869, 10173, 43082,
+      62083, 1767, 9974, 2290, 14356, 54424, 11089, 49980, 52949, 52707, 21710, 46501,
+      1038, 13633, 3513, 54697, 36567, 19649, 19693, 15775, 26039, 51399, 32002, 8868,
+      29855, 13402, 15442, 50622, 29155, 60725, 38481, 34749, 17259, 43659, 6806, 54905,
+      57496, 46116, 23239, 22106, 6073, 39254, 30942, 55541, 746, 44565, 12121, 14391,
+      29027, 24566, 61938, 41408, 32769, 13445, 12260, 59650, 57352, 25862, 15800, 16768,
+      54487, 22906, 980, 49569, 59820, 44971, 61957, 8450, 17645, 59622, 60548, 61279,
+      13672, 65236, 32747, 41541, 41210, 2900, 40246, 52871, 58410, 21270, 15519, 35936,
+      8386, 56135, 54975, 30968, 39444, 5127, 30401, 62944, 18791, 5114, 22769, 3867,
+      20193, 1139, 3822, 1032, 18018, 55069, 22699, 34277, 45250, 57917, 56398, 31598,
+      23298, 31760, 45627, 65292, 39005, 33033, 8892, 52591, 33202, 60920, 7594, 60187,
+      2402, 34806, 43952, 8879, 51968, 53310, 53220, 39779, 51400, 62462, 4283, 57890,
+      22297, 58736, 16716, 57406, 44360, 24193, 48221, 62878, 64898, 45234, 58557, 27084,
+      41500, 37557, 25779, 9877, 45311, 35469, 49043, 49841, 62599, 52626, 55608, 63798,
+      31429, 45526, 56556, 34365, 39275, 50497, 22363, 40135, 14945, 1933, 30477, 12453,
+      44713, 36337, 31049, 23639, 45382, 52921, 54999, 27939, 12863, 15738, 36429, 16843,
+      41859, 52853, 57147, 45769, 52077, 40533, 60288, 62355, 33244, 51691, 39942, 30985,
+      23110, 60480, 43674, 10429, 17247, 25986, 27578, 26544, 28551, 16518, 45673, 9301,
+      29431, 52087, 60736, 53906, 30644, 41461, 26921, 41335, 19445, 27740, 10722, 58295,
+      48367, 47315, 25019, 57875, 15666, 44265, 3211, 2734, 56908, 27854, 40721, 41223,
+      56920, 4838, 48674, 37709, 30997, 21677, 25326, 59537, 55111, 60620, 9116, 11978,
+      43190, 61720, 58735, 30755, 5074, 35825, 52866, 49139, 24841, 47862, 38296, 19934,
+      45229, 22180, 34466, 52794, 39480, 39799, 28942, 30851, 56519, 31840, 60530, 25032,
+      5133, 15901, 13094, 17931, 18962, 14352, 15903, 191, 28615, 63232, 45750, 12344,
+      35637, 48581, 20722, 43930, 6682, 38606, 33195, 36472, 2454, 15429, 43407, 56875,
+      12518, 38700, 30492, 61797, 27413, 34721, 51089, 55476, 7425, 11865, 4132, 33584,
+      47694, 42426, 6108, 50698, 22706, 43233, 50292, 21662, 37466, 59189, 12959, 22343,
+      12303, 30357, 10024, 39156, 12963, 9440, 27290, 8901, 39304, 33939, 15480, 48563,
+      41446, 60315, 61201, 58103, 37913, 19169, 28938, 24730, 18013, 15574, 33784, 65436,
+      21530, 4346, 48975, 55014, 40797, 19183, 58237, 26750, 38268, 2224, 12361, 27716,
+      55904, 61998, 36484, 6288, 26809, 25886, 31008, 42749, 58345, 59700, 44384, 3547,
+      59181, 57276, 18977, 37079, 3589, 27222, 21511, 46402, 34543, 29307, 61935, 51693,
+      25167, 47046, 22048, 47581, 8556, 14114, 39083, 51873, 23788, 11858, 16658, 39785,
+      13477, 3110, 57206, 31541, 5968, 46199, 32759, 17737, 10105, 63584, 15160, 63258,
+      44233, 62533, 20576, 10204, 24255, 55511, 56761, 7537, 43702, 9337, 11128, 43203,
+      16214, 57843, 42344, 11854, 10016, 14198, 45029, 47649, 1995, 9121, 43148, 3746,
+      18500, 59806, 62976, 26409, 56146, 53919, 31582, 24027, 41274, 58184, 18112, 63364,
+      53356, 7499, 43331, 42901, 28771, 45469, 62450, 4608, 21379, 39729, 32153, 10622,
+      34717, 32965, 6165, 14739, 15011, 58810, 35250, 53474, 19315, 19373, 6967, 45293,
+      57331, 12579, 31510, 63438, 6209, 4079, 29858, 18250, 23618, 23993, 42298, 64620,
+      22820, 29761, 2280, 22204, 42310, 53119, 21862, 7881, 62622, 34491, 52081, 52028,
+      62576, 48407, 11047, 33648, 21917, 46984, 39515, 50870, 61218, 29080, 41020, 49311,
+      21268, 14086, 60136, 39598, 6286, 17280, 22503, 38608, 65456, 11697, 42380, 49734,
+      28195, 56531, 30572, 10711, 65189, 3209, 59900, 5478, 11897, 5409, 24741, 9208,
+      7911, 56056, 10199, 64761, 37048, 38025, 8154, 7813, 41565, 33712, 24628, 3742,
+      19514, 30894, 9637, 12098, 60181, 47550, 49507, 35028, 59125, 42042, 39809, 24399,
+      13462, 32369, 15268, 44056, 33364, 3410, 30862, 52701, 52922, 63712, 36346, 11076,
+      21439, 13561, 42068, 6278, 30853, 15223, 10390, 22211, 8724, 22144, 765, 43534,
+      33207, 13725, 27397, 9286, 51651, 15324, 26613, 3693, 33232, 56322, 38325, 44137,
+      47835, 48540, 38996, 8716, 12309, 5014, 11760, 38559, 7561, 12779, 53809, 43787,
+      19424, 49880, 16188, 32705, 41477, 44430, 9799, 30498, 14011, 45347, 40396, 17602,
+      36979, 49290, 45856, 61870, 13584, 64554, 42467, 38897, 3134, 42566, 59381, 64878,
+      35402, 34075, 10817, 48718, 59063, 46881, 25562, 37193, 60799, 30092, 14924, 16006,
+      41825, 44602, 22366, 24514, 213, 65137, 19433, 9424, 41994, 5583, 18114, 53553,
+      25532, 25064, 5374, 4893, 6986, 24820, 26437, 59570, 11216, 12730, 17286, 17582,
+      24772, 9253, 16164, 58080, 2030, 61814, 15054, 8658, 19231, 2177, 9270, 54528,
+      4930, 54278, 16887, 45156, 6172, 45474, 13653, 13480, 10358, 37295, 31163, 39841,
+      35499, 16858, 59543, 29805, 39827, 54633, 7763, 52802, 18757, 10041, 25430, 55051,
+      23032, 5441, 54297, 7204, 21034, 64283, 14375, 49859, 34019, 15082, 48206, 50455,
+      57585, 6666, 40739, 22064, 4440, 11708, 49795, 27020, 64523, 57433, 12229, 31837,
+      51274, 11811, 574, 26553, 46257, 43267, 3285, 13467, 40412, 57561, 39669, 26462,
+      22699, 48941, 13399, 53020, 14398, 30374, 21778, 38896, 43155, 39333, 47229, 12462,
+      50693, 15702, 39201, 29611, 4730, 36958, 60224, 42249, 56127, 39551, 32562, 37661,
+      18865, 33206, 56741, 42900, 19217, 52623, 13837, 48361, 978, 64793, 64708, 7504,
+      57312, 13638, 39312, 16815, 24593, 15063, 30282, 29293, 6154, 9232, 49618, 45376,
+      40203, 36072, 36928, 19955, 22152, 53672, 53096, 7543, 13488, 31249, 26427, 3994,
+      51684, 22215, 38299, 27367, 26654, 32965, 19581, 52381, 11622, 35196, 56898, 27301,
+      17687, 3833, 48042, 7057, 32138, 61676, 47533, 21597, 42952, 3290, 57590, 20663,
+      39358, 22235, 41696, 8491, 41892, 6526, 4080, 46713, 51331, 22763, 21701, 65352,
+      35447, 23897, 61102, 60202, 24729, 37505, 10041, 41412, 60702, 50210, 49076, 50146,
+      39169, 8808, 49793, 35527, 64857, 38856, 24555, 19389, 63903, 62268, 56505, 24848,
+      43789, 54790, 37627, 45864, 5281, 37050, 25989, 10921, 22234, 35137, 42057, 64063,
+      15738, 9344, 8988, 34595, 47611, 17430, 51165, 52904, 37276, 23890, 172, 42360,
+      13462, 6301, 30464, 40437, 42415, 68, 26491, 37478, 46255, 48788, 5236, 61851,
+      17777, 27253, 54816, 52084, 64625, 60564, 57835, 9025, 10970, 60168, 52274, 13372,
+      46178, 57814, 15556, 5429, 23383, 31230, 51454, 15400, 46813, 31906, 23489, 49374,
+      39145, 32125, 26904, 23410, 64675, 51168, 4062, 59275, 12078, 56174, 32422, 5317,
+      63984, 60664, 20258, 46051, 12198, 51310, 50748, 41934, 205, 29425, 50051, 51954,
+      59361, 17221, 27115, 35084, 18983, 59174, 3922, 46655, 16371, 60586, 52306, 47136,
+      44996, 34483, 29333, 47445, 598, 20078, 50321, 52182, 52472, 2631, 37766, 55789,
+      11609, 60695, 4741, 37574, 29298, 50533, 49423, 59664, 38782, 21129, 53259, 65396,
+      31569, 29110, 9621, 65264, 21635, 61035, 13100, 56245, 17795, 60485, 49156, 28017,
+      44669, 26935, 24169, 8864, 30972, 23192, 31639, 13591, 10323, 32102, 21531, 26568,
+      41639, 9075, 968, 28800, 15843, 14092, 26242, 43843, 6353, 32476, 6328, 58291,
+      18121, 41924, 8615, 52357, 12562, 2256, 2941, 46657, 9432, 26580, 17682, 1634,
+      7947, 3468, 41293, 56272, 44591, 21718, 30084, 58811, 15293, 1054, 618, 4873,
+      37212, 54246, 4435, 62680, 61662, 42608, 42968, 26339, 33919, 58261, 3792, 31365,
+      41542, 61425, 34152, 26239, 55067, 15760, 46759, 13250, 487, 39574, 21614, 59578,
+      43060, 8215, 31031, 5933, 21296, 4956, 35810, 18208, 59636, 33429, 45791, 23724,
+      8847, 27958, 43965, 51296, 22341, 34259, 60571, 22242, 17030, 1466, 61458, 63025,
+      19900, 20406, 56488, 23801, 57886, 34780, 35878, 29564, 3194, 64912, 7686, 33060,
+      5449, 60771, 47193, 23777, 59787, 15845, 61737, 23187, 45559, 53089, 7972, 46696,
+      45413, 41427, 51868, 43940, 52182, 33099, 54497, 41873, 19787, 28310, 48854, 59,
+      38653, 43506, 56621, 23787, 37071, 37262, 14829, 48088, 33067, 7577, 53641, 10280,
+      54119, 57605, 7363, 2987, 53435, 55228, 5271, 7824, 45495, 52088, 37805, 36376,
+      64823, 41847, 47736, 29912, 17698, 27636, 64650, 6946, 19149, 24371, 55069, 25238,
+      60629, 59258, 43354, 49114, 4286, 3850, 21629, 25376, 60299, 58, 22023, 64901,
+      49476, 21430, 43066, 4000, 34883, 10334, 28258, 33936, 30879, 35707, 61578, 51948,
+      19804, 59100, 29610, 1057, 34419, 50661, 59892, 55442, 12580, 1076, 42555, 43176,
+      21015, 40537, 61809, 32651, 54141, 19204, 5403, 52208, 64270, 51455, 57996, 45377,
+      38368, 54489, 18818, 45200, 59291, 35385, 52334, 12734, 24293, 1376, 49917, 18602,
+      49148, 3873, 59812, 24026, 18184, 59254, 14324, 62520, 57247, 64546, 34958, 5681,
+      569, 25481, 42164, 31168, 10599, 23963, 9994, 36843, 29824, 4283, 22338, 53647,
+      24133, 636, 62595, 22015, 31464, 25463, 19473, 28915, 46146, 33518, 53549, 28610,
+      27130, 7298, 31182, 13585, 52703, 4213, 15067, 21837, 54948, 24940, 57644, 492,
+      21863, 60455, 19052, 35745, 3588, 41591, 36540, 29723, 36238, 23137, 15590, 31604,
+      62729, 2516, 52446, 30438, 12078, 388, 39675, 46582, 46141, 64048, 59696, 53244,
+      19323, 63992, 45154, 13159, 20774, 8930, 44582, 10617, 36238, 5378, 1566, 17694,
+      34781, 64344, 61724, 55856, 6825, 24999, 36977, 27700, 30238, 16891, 60355, 6152,
+      9814, 56261, 38358, 9655, 50333, 55299, 48694, 11770, 42099, 56093, 57458, 40710,
+      46162, 4240, 3521, 32201, 59413, 45146, 4163, 17556, 42372, 44848, 17021, 4132,
+      8879, 9678, 40644, 36328, 53041, 35566, 21663, 26777, 61551, 51024, 20268, 40755,
+      5024, 28158, 61632, 13089, 21659, 17014, 59684, 51116, 30468, 63140, 33619, 2087,
+      41677, 7693, 6878, 2519, 38528, 65377, 1173, 26696, 6354, 13350, 20702, 63639,
+      25036, 53377, 27402, 20456, 43497, 9512, 9595, 24187, 57896, 19489, 3394, 9099,
+      15753, 33788, 34229, 47909, 38432, 6292, 19336, 16485, 41548, 8472, 11490, 20556,
+      49741, 10038, 59963, 33518, 31507, 61825, 54314, 21636, 25307, 49321, 33130, 5154,
+      13418, 8698, 40814, 53684, 58090, 47464, 42539, 12163, 18939, 29638, 48332, 44810,
+      14178, 10432, 26756, 18213, 55670, 62140, 64037, 22653, 26093, 33294, 60191, 12394,
+      32373, 35958, 30128, 4878, 27142, 21524, 4424, 36738, 45035, 16016, 45532, 4947,
+      56570, 65178, 47372, 41033, 24343, 3043, 37591, 12425, 39796, 45870, 10850, 29464,
+      65522, 53412, 60297, 33745, 8693, 25896, 59842, 41440, 4617, 6142, 27180, 22974,
+      2731, 18177, 55695, 40700, 58687, 24693, 34786, 1427, 6695, 50937, 3319, 13344,
+      43292, 57791, 52605, 7034, 42091, 19947, 36890, 59743, 61344, 17830, 23526, 60132,
+      50654, 3433, 47172, 7924, 36890, 17410, 2344, 21456, 36526, 30562, 21362, 49570,
+      44280, 4758, 5741, 21821, 56541, 36829, 59862, 52405, 58029, 49890, 16478, 16497,
+      44351, 53708, 44982, 5289, 51074, 24936, 11474, 30989, 38039, 62841, 62971, 22086,
+      55267, 37665, 48693, 53857, 33374, 40374, 57908, 3318, 4870, 54754, 16716, 42570,
+      58971, 5427, 34282, 46079, 48449, 37942, 62432, 36974, 19489, 40483, 55055, 40328,
+      35984, 40607, 6672, 16247, 15323, 53147, 2997, 33530, 8864, 52640, 45558, 238,
+      26867, 8185, 29925, 57883, 9947, 40497, 51377, 5194, 37006, 21492, 35645, 1952,
+      24459, 52839, 53437, 42332, 10991, 10947, 54837, 61343, 53711, 20614, 18874, 22871,
+      29744, 27327, 32703, 22728, 10243, 57011, 62607, 12203, 5875, 54955, 43550, 37478,
+      21371, 14282, 55968, 15135, 48964, 56412, 7160, 50577, 40564, 11899, 10080, 4971,
+      27969, 54380, 40815, 34031, 26738, 24688, 6427, 59080, 33004, 25924, 57423, 52667,
+      49549, 29642, 33607, 33747, 36907, 26205, 52792, 58857, 27019, 8974, 38800, 5377,
+      19210, 59445, 15097, 239, 2543, 21784, 24861, 53383, 40009, 15450, 29646, 33002,
+      27586, 56869, 23166, 48563, 32735, 46447, 29583, 56479, 32298, 1136, 33527, 7306,
+      57216, 11155, 46852, 54385, 13692, 19319, 24869, 52770, 13025, 18526, 48698, 37085,
+      20069, 35761, 23864, 2439, 41899, 60938, 18167, 23649, 1886, 52295, 45552, 40959,
+      18877, 29040, 64731, 35168, 16265, 14140, 58900, 48470, 62644, 6609, 51367, 5475,
+      48740, 37172, 24778, 10076, 45302, 29482, 41316, 25695, 57997, 53232, 5224, 9535,
+      60362, 1364, 22378, 38798, 14225, 49790, 23717, 12579, 19728, 19137, 55161, 21916,
+      22313, 55649, 19589, 48648, 22542, 14002, 55169, 6674, 31603, 43224, 26882, 43719,
+      3239, 16935, 20470, 48243, 61221, 21068, 51639, 51877, 62896, 38255, 46687, 42606,
+      16871, 2211, 65474, 54769, 16214, 51632, 31794, 9449, 65025, 13966, 60933, 17519,
+      34838, 58511, 39713, 42829, 25749, 13185, 29621, 9823, 56841, 3389, 32249, 18182,
+      34354, 20233, 6088, 43503, 43917, 13154, 62449, 50708, 10947, 39960, 14827, 42613,
+      35487, 1282, 47639, 21395, 21691, 17461, 24548, 41278, 31586, 62484, 50602, 23167,
+      22171, 62564, 39979, 17632, 7045, 36119, 18462, 18385, 1592, 16906, 30013, 46069,
+      43799, 50152, 28012, 17633, 46825, 52548, 47508, 62935, 63278, 27825, 307, 61877,
+      20325, 1621, 48760, 65446, 36698, 50373, 44598, 56218, 28313, 58904, 57633, 1050,
+      60400, 23247, 7771, 29925, 25257, 60196, 16805, 15956, 31340, 5209, 33208, 65476,
+      38295, 8304, 35529, 13774, 62461, 1890, 33742, 16320, 51539, 44128, 25231, 35341,
+      3484, 22346, 63997, 59930, 1208, 61218, 37000, 33251, 32102, 59460, 49642, 39805,
+      2227, 54097, 63645, 1780, 5911, 2616, 41214, 56326, 51088, 12068, 65456, 45555,
+      12490, 45112, 43641, 8807, 58047, 51434, 3451, 62295, 3818, 43868, 44822, 40303,
+      56834, 33380, 61193, 58711, 7299, 29594, 10947, 22265, 37694, 45887, 35605, 30412,
+      18592, 16311, 7636, 6776, 6874, 19574, 52655, 35128, 61410, 21187, 36345, 22546,
+      24901, 24516, 17274, 20836, 58493, 57106, 43129, 51755, 36419, 15441, 8794, 44592,
+      5351, 58952, 51213, 30879, 19738, 60473, 721, 35143, 4849, 20640, 40176, 22687,
+      61394, 2399, 7778, 48231, 1316, 31799, 50388, 54817, 34413, 30367, 18913, 44181,
+      5784, 55131, 21116, 31626, 46329, 58554, 52812, 36709, 9806, 45067, 6699, 47439,
+      35084, 142, 20023, 25108, 16083, 6829, 37527, 52159, 24574, 10, 59351, 1041,
+      11797, 15907, 2871, 3612, 65009, 45261, 32324, 34704, 24130, 50632, 45098, 981,
+      510, 10005, 42976, 16847, 7417, 33264, 57368, 45857, 48411, 37049, 14787, 22101,
+      13396, 60761, 64956, 31855, 46103, 818, 51474, 40599, 49213, 22721, 21076, 13514,
+      34796, 10463, 7194, 10395, 53670, 15822, 31243, 6637, 3843, 42715, 18610, 4812,
+      17336, 50135, 51037, 21080, 61930, 42147, 9954, 41163, 7495, 33536, 49490, 43770,
+      13831, 53070, 8958, 29161, 4927, 11986, 5139, 58724, 51541, 55882, 9437, 55199,
+      37736, 60697, 61511, 44854, 35325, 49080, 21497, 59065, 69, 46632, 9089, 49589,
+      61325, 48468, 50707, 52585, 35774, 32552, 61401, 43177, 7547, 5907, 65532, 48170,
+      1200, 24278, 995, 33648, 49390, 45818, 42606, 48095, 15147, 35755, 52925, 32515,
+      58776, 53695, 20191, 17480, 33066, 14762, 20407, 61988, 9520, 61810, 21159, 49029,
+      52492, 19966, 53733, 39959, 5509, 26712, 18979, 51468, 16964, 41915, 3252, 18983,
+      43815, 5834, 6807, 49529, 45399, 59994, 16645, 27904, 32591, 37942, 37826, 51794,
+      32970, 15682, 28527, 55470, 63329, 61709, 614, 58331, 33739, 27085, 61228, 24016,
+      12483, 33844, 14205, 19172, 63682, 2365, 29488, 59219, 9618, 64568, 20161, 9244,
+      57734, 54755, 53317, 6092, 47951, 38753, 9656, 40586, 49643, 56592, 57811, 41013,
+      7033, 63159, 27112, 10699, 22426, 19339, 2498, 51284, 33276, 18395, 11945, 46973,
+      25262, 3746, 58911, 44141, 60748, 61161, 40190, 12196, 21712, 59178, 15194, 29885,
+      17206, 29903, 13186, 16956, 37001, 56175, 57685, 37675, 26434, 57949, 29566, 57834,
+      10269, 57928, 28631, 47242, 9772, 19143, 36044, 48743, 26590, 49283, 28226, 53575,
+      20355, 32243, 43488, 12588, 31394, 4083, 52687, 37284, 61179, 61932, 31160, 6753,
+      7401, 45942, 28862, 6445, 30994, 6650, 63000, 23541, 10251, 13854, 15166, 19305,
+      15899, 52176, 58963, 18102, 20346, 42944, 19250, 45304, 44269, 6916, 24899, 8706,
+      6793, 17813, 31803, 36363, 39855, 26054, 38539, 18420, 20352, 26812, 19130, 6895,
+      23753, 31467, 2472, 28741, 43115, 61850, 54074, 55736, 57868, 49502, 3509, 15296,
+      40992, 10713, 61850, 60973, 36189, 35444, 5724, 49747, 54728, 42927, 41863, 12865,
+      20699, 9854, 53999, 47930, 36230, 18015, 33100, 43718, 40611, 56948, 29193, 35244,
+      31279, 1733, 48618, 25099, 10037, 24663, 650, 6521, 64721, 12521, 60543, 50975,
+      64073, 2091, 8145, 58716, 12460, 36198, 43190, 38320, 48644, 45958, 16231, 28662,
+      29831, 33788, 31761, 35444, 14551, 41156, 20146, 52105, 21463, 31546, 41646, 8292,
+      44939, 801, 11896, 17555, 34196, 48947, 42790, 38411, 9911, 7811, 50460, 50087,
+      55966, 26800, 30509, 64374, 34126, 39614, 48508, 36143, 54565, 30113, 5359, 15726,
+      4827, 17197, 55654, 19994, 12652, 47714, 65326, 44750, 60640, 13757, 28094, 31739,
+      44189, 61416, 11869, 54557, 26026, 6858, 27794, 40480, 45235, 9863, 18467, 56759,
+      16167, 31685, 15195, 10926, 7373, 46480, 6737, 37454, 41148, 59506, 7988, 23380,
+      52861, 65115, 52678, 51727, 35315, 715, 3443, 51820, 45184, 46931, 23369, 2325,
+      52864, 33905, 41211, 23504, 17245, 54885, 809, 47658, 4275, 25222, 63124, 26470,
+      8566, 44364, 10878, 877, 12866, 61690, 62091, 31543, 6677, 25236, 48543, 12007,
+      979, 20875, 32710, 29079, 38797, 16066, 47269, 4485, 59536, 49628, 29166, 38380,
+      5633, 49312, 54886, 65078, 15654, 17763, 29219, 32179, 41871, 42027, 13752, 6237,
+      5365, 37295, 51269, 33582, 26382, 52442, 6510, 16919, 31774, 59347, 38065, 17458,
+      21938, 39131, 36261, 29017, 7368, 63923, 18847, 21845, 7412, 1491, 55381, 38495,
+      19627, 25631, 47741, 38289, 52219, 44384, 39867, 63404, 21868, 33481, 31220, 63354,
+      13878, 38568, 24185, 65112, 26014, 59855, 38440, 521, 5900, 58747, 13463, 29169,
+      33496, 47748, 21572, 43462, 47152, 15147, 17688, 55580, 58290, 38880, 60199, 60540,
+      47462, 50623, 37457, 9835, 39604, 9668, 24343, 45119, 25405, 9568, 38027, 38670,
+      34904, 33739, 44169, 59556, 40153, 42964, 23332, 163, 63719, 23214, 13967, 37596,
+      23852, 40421, 5258, 57707, 13767, 43509, 20551, 22667, 28997, 23933, 29781, 33765,
+      32958, 29073, 52680, 14048, 64876, 31257, 50563, 16092, 60724, 42730, 59669, 39214,
+      50872, 23987, 16639, 20211, 55874, 24719, 53407, 43059, 53259, 6856, 24635, 4712,
+      40544, 23373, 33551, 42379, 49558, 56993, 62137, 35072, 40273, 50749, 45039, 15894,
+      31515, 36863, 34240, 8314, 45959, 55237, 51854, 20996, 9359, 8211, 845, 62326,
+      17687, 1642, 38328, 35519, 39366, 39882, 9903, 44119, 41333, 19099, 29847, 55188,
+      65531, 43879, 58744, 28231, 29291, 41323, 31356, 57485, 32916, 22206, 43035, 39734,
+      62621, 11203, 8057, 13412, 36064, 36856, 59892, 15161, 58410, 46889, 25626, 41412,
+      56380, 8848, 17750, 62680, 56300, 2903, 557, 6966, 57470, 17865, 56137, 3364,
+      20205, 17420, 5935, 23219, 63504, 28300, 30063, 30375, 1138, 52592, 40744, 50301,
+      11602, 57605, 53329, 24727, 5543, 14964, 57523, 33769, 59530, 18022, 43349, 50822,
+      35936, 45857, 41005, 3098, 32731, 737, 59397, 63102, 677, 30425, 5340, 48406,
+      1558, 8381, 36726, 61978, 64553, 58140, 15475, 46027, 60724, 64866, 38087, 4408,
+      45010, 7918, 47716, 36370, 1819, 59600, 10474, 47748, 38518, 5092, 10925, 11541,
+      43294, 18658, 44931, 31408, 58501, 477, 2511, 53933, 4538, 42941, 65192, 37670,
+      52455, 57736, 40598, 13251, 49488, 45388, 57880, 25485, 43140, 38176, 62546, 6800,
+      8662, 30119, 10275, 12731, 29434, 48870, 31061, 21709, 62855, 14632, 2136, 56386,
+      27820, 56164, 20554, 33149, 23326, 37219, 40237, 18728, 30404, 57153, 9410, 24655,
+      38956, 22945, 4907, 45083, 47839, 41915, 61579, 646, 58988, 19097, 48644, 9706,
+      10714, 36571, 7790, 54213, 36785, 12042, 2451, 55241, 18592, 34795, 23664, 11959,
+      37174, 34411, 31570, 62499, 3005, 31733, 55052, 26801, 61971, 51415, 40815, 52228,
+      3992, 36236, 17911, 4543, 65151, 34283, 15174, 7843, 8741, 62631, 14611, 52134,
+      49509, 64769, 23223, 35343, 47460, 14467, 18317, 30849, 8830, 63996, 42669, 54655,
+      31292, 57358, 41333, 63386, 62634, 2310, 53418, 8871, 12866, 43228, 37136, 6430,
+      14815, 31971, 11660, 59828, 42958, 61584, 55420, 28702, 56954, 34358, 56141, 40854,
+      13130, 4534, 12494, 61968, 39676, 62067, 48614, 37567, 672, 9142, 49478, 45607,
+      53480, 29121, 5569, 2154, 6027, 63794, 63454, 23540, 425, 4306, 46999, 23047,
+      15424, 3149, 24282, 45350, 16155, 12675, 1455, 31241, 20011, 13045, 24317, 9726,
+      57674, 37, 63595, 52160, 59843, 36589, 16664, 12796, 19943, 58960, 57254, 4929,
+      47332, 29809, 51962, 35980, 42754, 33046, 20057, 25782, 5245, 38947, 62740, 31762,
+      30411, 41807, 30472, 61083, 63219, 24577, 14775, 2054, 40466, 18579, 61669, 43385,
+      31159, 25728, 25524, 50630, 50776, 50235, 4639, 26046, 19170, 20562, 33804, 44670,
+      22102, 12344, 48189, 61011, 3416, 59088, 35785, 5262, 18047, 50004, 45654, 23547,
+      38963, 22567, 797, 26035, 47067, 41981, 49363, 49549, 27350, 37127, 22211, 40401,
+      23956, 47020, 21249, 12619, 24339, 51288, 26126, 2748, 36843, 33012, 36577, 39378,
+      62771, 32792, 8034, 6507, 49889, 39510, 8314, 58673, 29472, 37143, 37145, 16233,
+      58079, 49453, 5710, 3182, 13982, 33832, 29549, 10640, 46746, 2091, 50326, 33647,
+      28197, 28924, 20583, 9997, 41468, 2392, 63785, 50696, 10013, 13250, 8704, 50830,
+      33383, 59008, 53018, 32884, 57626, 30209, 6300, 14825, 30220, 39685, 14039, 38492,
+      54144, 3773, 43227, 49442, 43194, 38788, 12209, 38230, 48058, 27758, 61365, 9760,
+      63054, 44365, 40741, 32553, 41276, 53345, 37391, 12236, 23203, 28670, 49533, 38720,
+      45050, 28325, 24070, 347, 33299, 53835, 49060, 51029, 2563, 62404, 15036, 55399,
+      18612, 47482, 20111, 51393, 64502, 18635, 26820, 7259, 51107, 1300, 51163, 9843,
+      30225, 6542, 56333, 18504, 45157, 40960, 56390, 43060, 40622, 12881, 48146, 5755,
+      3584, 47669, 10950, 28587, 3036, 46396, 38342, 20329, 39314, 20948, 48970, 28600,
+      40889, 56630, 64962, 48176, 12858, 3805, 44514, 2197, 6314, 63279, 59307, 14689,
+      35109, 1104, 22559, 44335, 30461, 29765, 43439, 43605, 43614, 48692, 37337, 60820,
+      32517, 57181, 56296, 3030, 6093, 36181, 49004, 2707, 22859, 46389, 53462, 34707,
+      8066, 5589, 26842, 4970, 62553, 57172, 7231, 15383, 19228, 24718, 55819, 28650,
+      13567, 50260, 28441, 16548, 41756, 47412, 13021, 59304, 15709, 27840, 61400, 64943,
+      57182, 34140, 59340, 61926, 53609, 28557, 48140, 17965, 403, 20892, 39968, 39166,
+      60763, 17232, 50382, 22788, 20286, 9339, 29079, 31101, 45236, 45270, 64227, 56716,
+      27445, 62919, 27241, 40509, 12978, 61102, 53464, 50135, 59129, 31855, 2442, 18546,
+      13094, 48050, 32224, 61367, 49298, 14980, 48586, 21710, 37583, 960, 33007, 39532,
+      50317, 20041, 55214, 26385, 62165, 7428, 12794, 31358, 29519, 35588, 29388, 21347,
+      17656, 22799, 34548, 27737, 23816, 47511, 1001, 25888, 21635, 26851, 53297, 62390,
+      12596, 23335, 5714, 11840, 24400, 53042, 4705, 11164, 35539, 58724, 24501, 34661,
+      55419, 33722, 30330, 6414, 11612, 56065, 42104, 21608, 14996, 45337, 25773, 34854,
+      52827, 55859, 34958, 55422, 20453, 62939, 24319, 51935, 8645, 34148, 7333, 16574,
+      45051, 27599, 20751, 27643, 37702, 2449, 21895, 17928, 4734, 65021, 17830, 16667,
+      6738, 52388, 52328, 55639, 1308, 8108, 38088, 36719, 47902, 22211, 2560, 39488,
+      8378, 54291, 31474, 53076, 10323, 34850, 30074, 15065, 59919, 4785, 44246, 54896,
+      24777, 28071, 62902, 50246, 5251, 16246, 38509, 41699, 30605, 45303, 63956, 44129,
+      61003, 241, 25687, 19959, 9043, 3775, 64508, 25113, 15556, 56181, 59768, 28020,
+      40228, 25562, 4165, 31865, 61647, 13629, 63699, 60011, 24563, 36179, 1211, 15363,
+      7391, 36579, 33713, 41926, 54871, 64563, 36031, 37359, 38003, 28140, 39847, 55542,
+      40794, 11324, 23450, 32197, 3760, 36121, 41979, 40657, 16415, 40614, 37860, 25732,
+      11545, 35162, 65436, 14425, 47047, 42395, 43471, 56307, 29175, 44162, 51343, 58810,
+      21542, 39517, 14549, 51005, 24804, 5866, 56, 146, 61177, 55705, 50672, 12189,
+      62852, 30739, 7610, 2844, 47007, 28356, 45490, 6277, 26593, 45376, 65507, 40339,
+      8369, 24609, 58677, 10983, 28943, 23575, 43443, 33039, 50812, 8250, 51803, 48536,
+      31412, 14513, 36911, 36609, 65119, 12346, 3855, 43371, 48745, 45759, 29638, 36246,
+      47314, 44869, 45627, 11433, 42584, 56120, 26981, 45810, 54137, 24735, 30947, 35702,
+      29823, 57942, 63765, 41036, 14713, 28926, 16119, 36352, 38004, 9000, 21511, 35215,
+      10193, 53042, 35698, 54114, 10621, 35718, 46873, 54374, 47263, 52044, 15341, 41423,
+      59751, 63631, 58676, 23970, 36613, 47503, 8366, 5761, 58832, 47080, 43231, 4288,
+      55842, 63125, 62274, 31667, 19885, 32408, 8930, 3974, 15185, 32986, 32621, 28528,
+      20040, 22388, 28972, 11975, 38859, 33173, 61926, 9253, 18530, 31733, 41360, 41231,
+      56596, 30010, 53172, 63085, 53422, 59919, 56107, 2808, 38422, 15807, 15916, 62826,
+      29928, 53074, 25097, 48499, 10701, 44776, 20240, 48128, 60588, 14425, 20119, 5226,
+      46425, 43054, 6419, 58532, 8955, 42889, 4175, 40195, 65048, 37657, 54148, 15102,
+      19877, 23560, 56107, 6072, 16499, 32245, 10361, 54229, 30297, 15270, 33734, 62769,
+      24364, 6235, 38199, 43669, 23521, 64110, 55717, 63439, 47715, 12191, 21159, 3310,
+      65509, 4537, 30521, 13937, 6712, 29244, 64478, 45769, 4808, 3638, 48681, 36334,
+      19600, 27065, 63418, 29639, 21975, 37725, 24972, 20406, 12898, 47749, 21254, 1615,
+      24946, 12036, 47184, 9738, 8031, 10048, 5080, 34683, 501, 5015, 47019, 37095,
+      14138, 48345, 8216, 53794, 40583, 9519, 57408, 7269, 47713, 38533, 504, 26461,
+      54791, 30659, 24369, 39080, 4575, 21515, 54974, 35894, 24882, 15884, 60412, 19609,
+      45203, 5051, 49621, 46237, 17930, 50499, 55203, 19526, 32053, 14594, 42015, 53297,
+      24280, 26240, 54665, 64318, 23471, 14625, 48701, 5165, 2246, 36584, 31373, 46092,
+      11932, 41394, 41737, 32095, 4150, 6476, 33587, 25042, 5635, 55864, 21674, 50799,
+      64821, 35948, 33049, 10183, 16357, 33648, 65317, 54907, 7534, 8088, 49516, 45262,
+      9681, 31685, 3567, 46377, 1263, 42219, 12374, 54770, 24002, 2466, 62989, 49295,
+      29408, 54387, 56142, 55467, 61480, 55496, 8430, 13372, 3556, 6232, 260, 57422,
+      39209, 14977, 48154, 20236, 52914, 51638, 14559, 19705, 31549, 42193, 8151, 17927,
+      41669, 22773, 63866, 109, 2393, 66, 47307, 54802, 38933, 14307, 1192, 53416,
+      1953, 15342, 30885, 22780, 13476, 30713, 35983, 16449, 31621, 50336, 1502, 46758,
+      45066, 46546, 55425, 57106, 54547, 20482, 52676, 3994, 21187, 23390, 22895, 44020,
+      17176, 65394, 36730, 65529, 39196, 7327, 2848, 37819, 6518, 40279, 18999, 41259,
+      11244, 24407, 2253, 58631, 13144, 2929, 32896, 30749, 2964, 62035, 49790, 28375,
+      51213, 47951, 56289, 59798, 39027, 49823, 37258, 61477, 43449, 2563, 39878, 63001,
+      61788, 61954, 28699, 33622, 28174, 38430, 48526, 15551, 12206, 27710, 57676, 27237,
+      62687, 26402, 34122, 34456, 25138, 49741, 54490, 48628, 43732, 24537, 62804, 59890,
+      33182, 10415, 8121, 4776, 38266, 25670, 51889, 3769, 51059, 57128, 24187, 28505,
+      17167, 34486, 38722, 19424, 4073, 7681, 47903, 52117, 22688, 51735, 19099, 53020,
+      39676, 36596, 51541, 19350, 13742, 29270, 64715, 46714, 45599, 30493, 13493, 39045,
+      45817, 62785, 31238, 52129, 57855, 39606, 519, 44231, 36521, 52109, 23913, 29752,
+      28742, 44352, 3697, 23345, 9586, 46250, 58807, 37070, 28330, 24991, 5102, 27150,
+      8191, 41567, 43553, 33348, 41145, 35122, 37476, 25109, 52172, 61054, 47692, 45035,
+      33046, 39539, 63158, 58805, 45149, 42086, 6090, 64764, 22922, 48029, 52963, 53899,
+      15406, 55741, 6500, 11052, 30666, 60002, 19846, 58467, 52452, 23299, 9742, 37355,
+      59834, 44569, 35406, 21320, 58719, 47405, 39020, 19001, 37565, 18444, 5605, 42252,
+      56631, 17217, 10289, 4634, 13565, 1100, 64484, 19403, 18319, 33397, 36524, 58578,
+      2526, 63172, 21121, 53768, 19257, 54089, 60518, 51948, 43410, 9588, 5166, 51905,
+      9218, 60280, 8625, 16827, 63171, 3306, 58714, 8406, 32319, 31869, 12128, 38776,
+      56867, 37142, 11083, 34600, 58950, 35106, 49383, 17951, 691, 12488, 24071, 18725,
+      28973, 47541, 43089, 35414, 14737, 12745, 27665, 16082, 40044, 12070, 480, 53346,
+      20088, 36987, 56609, 4553, 63469, 19349, 62509, 17095, 36634, 8109, 12214, 41023,
+      5248, 63288, 711, 4751, 19919, 55598, 9704, 47285, 8411, 63609, 15458, 52532,
+      41264, 14592, 8184, 63152, 9819, 38777, 35714, 40290, 12741, 24374, 23998, 63989,
+      41, 50329, 18670, 8118, 11941, 39825, 50835, 29164, 50938, 4878, 4610, 59079,
+      37432, 64992, 44706, 4083,
+    };
+
+    const auto x = static_cast<std::uint32_t>(n);
+    if (x == 2 || x == 3 || x == 5 || x == 7)
+    {
+      return true;
+    }
+    if (x % 2 == 0 || x % 3 == 0 || x % 5 == 0 || x % 7 == 0)
+    {
+      return false;
+    }
+    if (x < 121)
+    {
+      return x > 1;
+    }
+
+    std::uint32_t h = x;
+    h = ((h >> 16) ^ h) * 0x45d9f3bu;
+    h = ((h >> 16) ^ h) * 0x45d9f3bu;
+    h = ((h >> 16) ^ h) & 4095u;
+    return isStrongProbablePrime(Montgomery<std::uint32_t>(x), std::uint32_t{bases[h]});
+  }
+  else
+  {
+    if (n <= std::numeric_limits<std::uint32_t>::max())
+    {
+      return isPrime(static_cast<std::uint32_t>(n));
+    }
+    if (n % 2 == 0 || n % 3 == 0 || n % 5 == 0 || n % 7 == 0)
+    {
+      return false;
+    }
+
+    const Montgomery<std::uint64_t> mont(n);
+    for (std::uint64_t base : {2ull, 325ull, 9375ull, 28178ull, 450775ull, 9780504ull, 1795265022ull})
+    {
+      if (!isStrongProbablePrime(mont, base))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+//////////////////////////////////////////////////////////////////
+// wide integers
+//////////////////////////////////////////////////////////////////
+
+/**
+ * Unsigned integer of arbitrary size for everything that does not fit in 64 bits. Stored as
+ * 32-bit limbs, least significant first, without leading zero limbs so zero has no limbs.
+ */
+class BigInt
+{
+public:
+  BigInt() = default;
+
+  BigInt(std::uint64_t value)
+  {
+    while (value != 0)
+    {
+      limbs_.push_back(static_cast<std::uint32_t>(value));
+      value >>= 32;
+    }
+  }
+
+  /**
+   * Parse a string of decimal digits, throws std::invalid_argument for anything else.
+   */
+  static BigInt fromString(const std::string& number)
+  {
+    if (number.empty())
+    {
+      throw std::invalid_argument("empty number");
+    }
+
+    BigInt result;
+    std::uint32_t chunk = 0;
+    std::uint32_t scale = 1;
+    for (auto c : number)
+    {
+      if (!isdigit(static_cast<unsigned char>(c)))
+      {
+        throw std::invalid_argument("not a number '" + number + "'");
+      }
+      chunk = chunk * 10 + static_cast<std::uint32_t>(c - '0');
+      scale *= 10;
+      if (scale == 1'000'000'000)
+      {
+        result.multiplyAdd(scale, chunk);
+        chunk = 0;
+        scale = 1;
+      }
+    }
+    result.multiplyAdd(scale, chunk);
+    return result;
+  }
+
+  /**
+   * Construct from limbs, least significant first.
+   */
+  static BigInt fromLimbs(std::vector<std::uint32_t> limbs)
+  {
+    BigInt result;
+    result.limbs_ = std::move(limbs);
+    result.trim();
+    return result;
+  }
+
+  std::string toString() const
+  {
+    if (isZero())
+    {
+      return "0";
+    }
+
+    // nine decimal digits at a time, least significant chunk first
+    std::vector<std::uint32_t> chunks;
+    auto rest = *this;
+    while (!rest.isZero())
+    {
+      chunks.push_back(rest.divideSmall(1'000'000'000));
+    }
+
+    std::string result = std::to_string(chunks.back());
+    for (auto it = chunks.rbegin() + 1; it != chunks.rend(); ++it)
+    {
+      const auto digits = std::to_string(*it);
+      result.append(9 - digits.length(), '0').append(digits);
+    }
+    return result;
+  }
+
+  const std::vector<std::uint32_t>& limbs() const noexcept
+  {
+    return limbs_;
+  }
+
+  bool isZero() const noexcept
+  {
+    return limbs_.empty();
+  }
+
+  bool isOdd() const noexcept
+  {
+    return !limbs_.empty() && (limbs_.front() & 1) != 0;
+  }
+
+  std::size_t bitLength() const noexcept
+  {
+    return limbs_.empty() ? 0 : 32 * (limbs_.size() - 1) + std::bit_width(limbs_.back());
+  }
+
+  bool bit(std::size_t i) const noexcept
+  {
+    return i / 32 < limbs_.size() && ((limbs_[i / 32] >> (i % 32)) & 1) != 0;
+  }
+
+  /**
+   * The low 64 bits.
+   */
+  std::uint64_t toUint64() const noexcept
+  {
+    std::uint64_t value = 0;
+    for (std::size_t i = std::min<std::size_t>(limbs_.size(), 2); i-- > 0;)
+    {
+      value = (value << 32) | limbs_[i];
+    }
+    return value;
+  }
+
+  /**
+   * this = this / divisor, returns the remainder.
+   */
+  std::uint32_t divideSmall(std::uint32_t divisor) noexcept
+  {
+    std::uint64_t remainder = 0;
+    for (auto i = limbs_.size(); i-- > 0;)
+    {
+      const auto current = (remainder << 32) | limbs_[i];
+      limbs_[i] = static_cast<std::uint32_t>(current / divisor);
+      remainder = current % divisor;
+    }
+    trim();
+    return static_cast<std::uint32_t>(remainder);
+  }
+
+  std::uint32_t modSmall(std::uint32_t divisor) const noexcept
+  {
+    std::uint64_t remainder = 0;
+    for (auto i = limbs_.size(); i-- > 0;)
+    {
+      remainder = ((remainder << 32) | limbs_[i]) % divisor;
+    }
+    return static_cast<std::uint32_t>(remainder);
+  }
+
+  /**
+   * this = this * factor + addend
+   */
+  void multiplyAdd(std::uint32_t factor, std::uint32_t addend)
+  {
+    std::uint64_t carry = addend;
+    for (auto& limb : limbs_)
+    {
+      const auto current = static_cast<std::uint64_t>(limb) * factor + carry;
+      limb = static_cast<std::uint32_t>(current);
+      carry = current >> 32;
+    }
+    if (carry != 0)
+    {
+      limbs_.push_back(static_cast<std::uint32_t>(carry));
+    }
+  }
+
+  friend bool operator==(const BigInt& a, const BigInt& b) noexcept
+  {
+    return a.limbs_ == b.limbs_;
+  }
+
+  friend bool operator!=(const BigInt& a, const BigInt& b) noexcept
+  {
+    return !(a == b);
+  }
+
+  friend bool operator<(const BigInt& a, const BigInt& b) noexcept
+  {
+    if (a.limbs_.size() != b.limbs_.size())
+    {
+      return a.limbs_.size() < b.limbs_.size();
+    }
+    return std::lexicographical_compare(a.limbs_.rbegin(), a.limbs_.rend(), b.limbs_.rbegin(), b.limbs_.rend());
+  }
+
+  friend bool operator>(const BigInt& a, const BigInt& b) noexcept
+  {
+    return b < a;
+  }
+
+  friend bool operator<=(const BigInt& a, const BigInt& b) noexcept
+  {
+    return !(b < a);
+  }
+
+  friend bool operator>=(const BigInt& a, const BigInt& b) noexcept
+  {
+    return !(a < b);
+  }
+
+  BigInt& operator+=(const BigInt& other)
+  {
+    if (limbs_.size() < other.limbs_.size())
+    {
+      limbs_.resize(other.limbs_.size(), 0);
+    }
+    std::uint64_t carry = 0;
+    for (std::size_t i = 0; i < limbs_.size(); ++i)
+    {
+      carry += static_cast<std::uint64_t>(limbs_[i]) + (i < other.limbs_.size() ? other.limbs_[i] : 0);
+      limbs_[i] = static_cast<std::uint32_t>(carry);
+      carry >>= 32;
+      if (carry == 0 && i >= other.limbs_.size())
+      {
+        break;
+      }
+    }
+    if (carry != 0)
+    {
+      limbs_.push_back(static_cast<std::uint32_t>(carry));
+    }
+    return *this;
+  }
+
+  /**
+   * this = this - other, other must not be larger than this.
+   */
+  BigInt& operator-=(const BigInt& other)
+  {
+    assert(other <= *this);
+    std::int64_t borrow = 0;
+    for (std::size_t i = 0; i < limbs_.size(); ++i)
+    {
+      borrow += static_cast<std::int64_t>(limbs_[i]) - (i < other.limbs_.size() ? other.limbs_[i] : 0);
+      limbs_[i] = static_cast<std::uint32_t>(borrow);
+      borrow = (borrow < 0) ? -1 : 0;
+      if (borrow == 0 && i >= other.limbs_.size())
+      {
+        break;
+      }
+    }
+    trim();
+    return *this;
+  }
+
+  BigInt& operator<<=(std::size_t bits)
+  {
+    if (isZero())
+    {
+      return *this;
+    }
+    const auto shift = static_cast<unsigned>(bits % 32);
+    if (shift != 0)
+    {
+      limbs_.push_back(0);
+      for (auto i = limbs_.size(); i-- > 1;)
+      {
+        limbs_[i] = (limbs_[i] << shift) | (limbs_[i - 1] >> (32 - shift));
+      }
+      limbs_.front() <<= shift;
+    }
+    limbs_.insert(limbs_.begin(), bits / 32, 0);
+    trim();
+    return *this;
+  }
+
+  BigInt& operator>>=(std::size_t bits)
+  {
+    if (bits / 32 >= limbs_.size())
+    {
+      limbs_.clear();
+      return *this;
+    }
+    limbs_.erase(limbs_.begin(), limbs_.begin() + static_cast<std::ptrdiff_t>(bits / 32));
+    const auto shift = static_cast<unsigned>(bits % 32);
+    if (shift != 0)
+    {
+      for (std::size_t i = 0; i + 1 < limbs_.size(); ++i)
+      {
+        limbs_[i] = (limbs_[i] >> shift) | (limbs_[i + 1] << (32 - shift));
+      }
+      limbs_.back() >>= shift;
+    }
+    trim();
+    return *this;
+  }
+
+  friend BigInt operator+(BigInt a, const BigInt& b)
+  {
+    return a += b;
+  }
+
+  friend BigInt operator-(BigInt a, const BigInt& b)
+  {
+    return a -= b;
+  }
+
+  friend BigInt operator<<(BigInt a, std::size_t bits)
+  {
+    return a <<= bits;
+  }
+
+  friend BigInt operator>>(BigInt a, std::size_t bits)
+  {
+    return a >>= bits;
+  }
+
+  friend BigInt operator*(const BigInt& a, const BigInt& b)
+  {
+    const auto shorter = std::min(a.limbs_.size(), b.limbs_.size());
+    if (shorter < karatsubaThreshold)
+    {
+      return multiplySchoolbook(a, b);
+    }
+    if (shorter < nttThreshold)
+    {
+      return multiplyKaratsuba(a, b);
+    }
+    return multiplyNtt(a, b);
+  }
+
+  BigInt& operator*=(const BigInt& other)
+  {
+    return *this = *this * other;
+  }
+
+  /**
+   * Long division, Knuth's algorithm D, or multiplication with a Newton reciprocal when both the
+   * divisor and the quotient are large. Throws std::domain_error when dividing by zero.
+   */
+  static void divide(const BigInt& a, const BigInt& b, BigInt& quotient, BigInt& remainder)
+  {
+    if (b.isZero())
+    {
+      throw std::domain_error("division by zero");
+    }
+    if (a < b)
+    {
+      quotient = BigInt();
+      remainder = a;
+      return;
+    }
+    if (b.limbs_.size() >= newtonThreshold && a.limbs_.size() - b.limbs_.size() >= newtonThreshold)
+    {
+      divideNewton(a, b, quotient, remainder);
+      return;
+    }
+    divideKnuth(a, b, quotient, remainder);
+  }
+
+  friend BigInt operator/(const BigInt& a, const BigInt& b)
+  {
+    BigInt quotient, remainder;
+    divide(a, b, quotient, remainder);
+    return quotient;
+  }
+
+  friend BigInt operator%(const BigInt& a, const BigInt& b)
+  {
+    BigInt quotient, remainder;
+    divide(a, b, quotient, remainder);
+    return remainder;
+  }
+
+private:
+  // limb counts where the next multiplication resp. division algorithm starts to pay off
+  static constexpr std::size_t karatsubaThreshold = 40;
+  static constexpr std::size_t nttThreshold = 1500;
+  static constexpr std::size_t newtonThreshold = 200;
+
+  void trim() noexcept
+  {
+    while (!limbs_.empty() && limbs_.back() == 0)
+    {
+      limbs_.pop_back();
+    }
+  }
+
+  /**
+   * limbs [from, to) of x
+   */
+  static BigInt slice(const BigInt& x, std::size_t from, std::size_t to)
+  {
+    to = std::min(to, x.limbs_.size());
+    if (from >= to)
+    {
+      return BigInt();
+    }
+    return fromLimbs(std::vector<std::uint32_t>(x.limbs_.begin() + from, x.limbs_.begin() + to));
+  }
+
+  static BigInt multiplySchoolbook(const BigInt& a, const BigInt& b)
+  {
+    BigInt result;
+    if (a.isZero() || b.isZero())
+    {
+      return result;
+    }
+    result.limbs_.assign(a.limbs_.size() + b.limbs_.size(), 0);
+    for (std::size_t i = 0; i < a.limbs_.size(); ++i)
+    {
+      std::uint64_t carry = 0;
+      const std::uint64_t ai = a.limbs_[i];
+      for (std::size_t j = 0; j < b.limbs_.size(); ++j)
+      {
+        carry += ai * b.limbs_[j] + result.limbs_[i + j];
+        result.limbs_[i + j] = static_cast<std::uint32_t>(carry);
+        carry >>= 32;
+      }
+      result.limbs_[i + b.limbs_.size()] = static_cast<std::uint32_t>(carry);
+    }
+    result.trim();
+    return result;
+  }
+
+  /**
+   * Knuth's algorithm D
+   */
+  static void divideKnuth(const BigInt& a, const BigInt& b, BigInt& quotient, BigInt& remainder)
+  {
+    if (a < b)
+    {
+      quotient = BigInt();
+      remainder = a;
+      return;
+    }
+    if (b.limbs_.size() == 1)
+    {
+      quotient = a;
+      remainder = BigInt(quotient.divideSmall(b.limbs_.front()));
+      return;
+    }
+
+    // normalize so the top limb of the divisor has its high bit set, then the estimate of
+    // each quotient limb from the top two limbs is at most two too large
+    const auto shift = static_cast<std::size_t>(std::countl_zero(b.limbs_.back()));
+    const auto v = b << shift;
+    auto u = a << shift;
+    u.limbs_.push_back(0);
+
+    const auto n = v.limbs_.size();
+    const auto m = u.limbs_.size() - n;
+    const std::uint64_t base = 1ull << 32;
+    quotient.limbs_.assign(m, 0);
+
+    for (auto j = m; j-- > 0;)
+    {
+      const auto top = (static_cast<std::uint64_t>(u.limbs_[j + n]) << 32) | u.limbs_[j + n - 1];
+      auto qhat = top / v.limbs_[n - 1];
+      auto rhat = top % v.limbs_[n - 1];
+      while (qhat >= base || qhat * v.limbs_[n - 2] > ((rhat << 32) | u.limbs_[j + n - 2]))
+      {
+        --qhat;
+        rhat += v.limbs_[n - 1];
+        if (rhat >= base)
+        {
+          break;
+        }
+      }
+
+      // u[j..j+n] -= qhat * v
+      std::int64_t borrow = 0;
+      std::uint64_t carry = 0;
+      for (std::size_t i = 0; i < n; ++i)
+      {
+        const auto product = qhat * v.limbs_[i] + carry;
+        carry = product >> 32;
+        const auto difference = static_cast<std::int64_t>(u.limbs_[i + j]) - static_cast<std::uint32_t>(product) + borrow;
+        u.limbs_[i + j] = static_cast<std::uint32_t>(difference);
+        borrow = difference >> 32;
+      }
+      const auto difference = static_cast<std::int64_t>(u.limbs_[j + n]) - static_cast<std::int64_t>(carry) + borrow;
+      u.limbs_[j + n] = static_cast<std::uint32_t>(difference);
+
+      if (difference < 0)
+      {
+        // qhat was one too large, add v back
+        --qhat;
+        std::uint64_t sum = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+          sum += static_cast<std::uint64_t>(u.limbs_[i + j]) + v.limbs_[i];
+          u.limbs_[i + j] = static_cast<std::uint32_t>(sum);
+          sum >>= 32;
+        }
+        u.limbs_[j + n] += static_cast<std::uint32_t>(sum);
+      }
+      quotient.limbs_[j] = static_cast<std::uint32_t>(qhat);
+    }
+
+    quotient.trim();
+    u.limbs_.resize(n);
+    u.trim();
+    remainder = u >> shift;
+  }
+
+  /**
+   * Three half size products instead of four, (a1 B + a0)(b1 B + b0) = a1 b1 B^2 + a0 b0
+   * + ((a0 + a1)(b0 + b1) - a1 b1 - a0 b0) B. A much shorter operand is instead multiplied
+   * with each half of the longer one.
+   */
+  static BigInt multiplyKaratsuba(const BigInt& a, const BigInt& b)
+  {
+    const auto half = std::max(a.limbs_.size(), b.limbs_.size()) / 2;
+    if (std::min(a.limbs_.size(), b.limbs_.size()) <= half)
+    {
+      const auto& longer = (a.limbs_.size() > b.limbs_.size()) ? a : b;
+      const auto& shorter = (a.limbs_.size() > b.limbs_.size()) ? b : a;
+      return slice(longer, 0, half) * shorter + ((slice(longer, half, longer.limbs_.size()) * shorter) << (32 * half));
+    }
+
+    const auto a0 = slice(a, 0, half);
+    const auto a1 = slice(a, half, a.limbs_.size());
+    const auto b0 = slice(b, 0, half);
+    const auto b1 = slice(b, half, b.limbs_.size());
+    const auto low = a0 * b0;
+    const auto high = a1 * b1;
+    const auto middle = (a0 + a1) * (b0 + b1) - low - high;
+    return low + (middle << (32 * half)) + (high << (64 * half));
+  }
+
+  /**
+   * Number theoretic transform in place modulo the prime 2^64 - 2^32 + 1, which has roots of
+   * unity of every power of two order up to 2^32. Only the twiddles are in Montgomery form, so
+   * the values come out as plain numbers.
+   */
+  static void transform(std::vector<std::uint64_t>& values, bool inverse, const Montgomery<std::uint64_t>& mont)
+  {
+    const auto size = values.size();
+    for (std::size_t i = 1, j = 0; i < size; ++i)
+    {
+      auto bit = size >> 1;
+      for (; (j & bit) != 0; bit >>= 1)
+      {
+        j ^= bit;
+      }
+      j ^= bit;
+      if (i < j)
+      {
+        std::swap(values[i], values[j]);
+      }
+    }
+
+    const auto prime = mont.modulus();
+    const auto generator = mont.toMontgomery(7);
+    std::vector<std::uint64_t> twiddles;
+    for (std::size_t length = 2; length <= size; length <<= 1)
+    {
+      auto root = mont.power(generator, (prime - 1) / length);
+      if (inverse)
+      {
+        root = mont.power(root, length - 1);
+      }
+
+      const auto half = length / 2;
+      twiddles.assign(half, mont.one());
+      for (std::size_t j = 1; j < half; ++j)
+      {
+        twiddles[j] = mont.multiply(twiddles[j - 1], root);
+      }
+
+      for (std::size_t i = 0; i < size; i += length)
+      {
+        for (std::size_t j = 0; j < half; ++j)
+        {
+          const auto u = values[i + j];
+          const auto t = mont.multiply(values[i + j + half], twiddles[j]);
+          values[i + j] = mont.add(u, t);
+          values[i + j + half] = mont.subtract(u, t);
+        }
+      }
+    }
+  }
+
+  /**
+   * Multiplication as a convolution of 16-bit digits through the number theoretic transform,
+   * O(n log n). With 16-bit digits a coefficient of the product is at most n * 2^32 which stays
+   * below the prime for any size the transform supports. A square needs one transform less.
+   */
+  static BigInt multiplyNtt(const BigInt& a, const BigInt& b)
+  {
+    const Montgomery<std::uint64_t> mont(0xffffffff00000001ull);
+    const auto digits = 2 * (a.limbs_.size() + b.limbs_.size());
+    const auto size = std::bit_ceil(digits);
+
+    const auto toDigits = [&](const BigInt& x) {
+      std::vector<std::uint64_t> values(size, 0);
+      for (std::size_t i = 0; i < x.limbs_.size(); ++i)
+      {
+        values[2 * i] = x.limbs_[i] & 0xffffu;
+        values[2 * i + 1] = x.limbs_[i] >> 16;
+      }
+      transform(values, false, mont);
+      return values;
+    };
+    auto x = toDigits(a);
+    if (&a == &b)
+    {
+      for (auto& value : x)
+      {
+        value = mont.multiply(value, value);
+      }
+    }
+    else
+    {
+      const auto y = toDigits(b);
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        x[i] = mont.multiply(x[i], y[i]);
+      }
+    }
+    transform(x, true, mont);
+
+    // the pointwise products left a factor 1/R, multiply with R^2/size to scale and undo it
+    const auto scale = mont.toMontgomery(mont.toMontgomery(mont.modulus() - (mont.modulus() - 1) / size));
+    std::vector<std::uint32_t> limbs(a.limbs_.size() + b.limbs_.size(), 0);
+    std::uint64_t carry = 0;
+    for (std::size_t i = 0; i < digits; ++i)
+    {
+      carry += mont.multiply(x[i], scale);
+      limbs[i / 2] |= static_cast<std::uint32_t>(carry & 0xffffu) << (16 * (i % 2));
+      carry >>= 16;
+    }
+    return fromLimbs(std::move(limbs));
+  }
+
+  /**
+   * floor(2^(2n) / b), possibly a few units too small or too large, for a b of exactly n bits.
+   * Newton iteration r = r + r (2^(2n) - b r) / 2^(2n) starting from the reciprocal of the top
+   * half of b, so the work is dominated by the two multiplications at full precision.
+   */
+  static BigInt reciprocal(const BigInt& b, std::size_t n)
+  {
+    if (n <= 32 * newtonThreshold)
+    {
+      BigInt quotient, remainder;
+      divideKnuth(BigInt(1) << (2 * n), b, quotient, remainder);
+      return quotient;
+    }
+
+    const auto h = n / 2 + 32; // a few guard bits
+    const auto r = reciprocal(b >> (n - h), h) << (n - h);
+    const auto one = BigInt(1) << (2 * n);
+    const auto br = b * r;
+    return (br <= one) ? r + ((r * (one - br)) >> (2 * n)) : r - ((r * (br - one)) >> (2 * n));
+  }
+
+  /**
+   * Division by multiplication with the reciprocal of b, a is consumed n bits at a time from
+   * the top so every step divides a number below 2^(2n).
+   */
+  static void divideNewton(const BigInt& a, const BigInt& b, BigInt& quotient, BigInt& remainder)
+  {
+    const auto n = b.bitLength();
+    const auto r = reciprocal(b, n);
+    const auto chunks = (a.bitLength() + n - 1) / n;
+
+    BigInt q;
+    BigInt rest;
+    for (auto i = chunks; i-- > 0;)
+    {
+      auto x = (rest << n) + lowBits(a >> (i * n), n);
+      auto estimate = (x * r) >> (2 * n);
+      auto product = estimate * b;
+      while (product > x)
+      {
+        estimate -= BigInt(1);
+        product -= b;
+      }
+      rest = x - product;
+      while (rest >= b)
+      {
+        rest -= b;
+        estimate += BigInt(1);
+      }
+      q = (q << n) + estimate;
+    }
+    quotient = std::move(q);
+    remainder = std::move(rest);
+  }
+
+  /**
+   * x mod 2^bits
+   */
+  static BigInt lowBits(const BigInt& x, std::size_t bits)
+  {
+    auto result = slice(x, 0, (bits + 31) / 32);
+    if (bits % 32 != 0 && result.limbs_.size() == (bits + 31) / 32)
+    {
+      result.limbs_.back() &= (1u << (bits % 32)) - 1;
+      result.trim();
+    }
+    return result;
+  }
+
+  std::vector<std::uint32_t> limbs_;
+};
+
+/**
+ * BigInt counterpart of std::countr_zero.
+ */
+inline int trailingZeros(const BigInt& value) noexcept
+{
+  const auto& limbs = value.limbs();
+  for (std::size_t i = 0; i < limbs.size(); ++i)
+  {
+    if (limbs[i] != 0)
+    {
+      return static_cast<int>(32 * i) + std::countr_zero(limbs[i]);
+    }
+  }
+  return 0;
+}
+
+/**
+ * Integer square root, Newton iteration from above.
+ */
+BigInt squareRoot(const BigInt& n)
+{
+  if (n.isZero())
+  {
+    return n;
+  }
+  auto x = BigInt(1) << ((n.bitLength() + 1) / 2);
+  for (;;)
+  {
+    const auto y = (x + n / x) >> 1;
+    if (y >= x)
+    {
+      return x;
+    }
+    x = y;
+  }
+}
+
+/**
+ * Montgomery arithmetic modulo an odd BigInt, the multi-limb counterpart of Montgomery<T> with the
+ * same interface so that isStrongProbablePrime() works for both. R = 2^(32*limbs of n) and the
+ * product is reduced limb by limb (CIOS) so no double length intermediate is needed.
+ */
+class BigMontgomery
+{
+public:
+  explicit BigMontgomery(const BigInt& n)
+    : n_(n)
+    , size_(n.limbs().size())
+  {
+    assert(n.isOdd());
+
+    // -n^-1 mod 2^32
+    std::uint32_t inverse = n.limbs().front();
+    for (int i = 0; i < 4; ++i)
+    {
+      inverse *= 2 - n.limbs().front() * inverse;
+    }
+    inverse_ = 0u - inverse;
+
+    one_ = (BigInt(1) << (32 * size_)) % n_;
+    r2_ = (one_ * one_) % n_;
+  }
+
+  const BigInt& modulus() const noexcept
+  {
+    return n_;
+  }
+
+  const BigInt& one() const noexcept
+  {
+    return one_;
+  }
+
+  BigInt toMontgomery(const BigInt& a) const
+  {
+    return multiply(a < n_ ? a : a % n_, r2_);
+  }
+
+  BigInt fromMontgomery(const BigInt& a) const
+  {
+    return multiply(a, BigInt(1));
+  }
+
+  BigInt add(const BigInt& a, const BigInt& b) const
+  {
+    auto sum = a + b;
+    if (sum >= n_)
+    {
+      sum -= n_;
+    }
+    return sum;
+  }
+
+  BigInt subtract(const BigInt& a, const BigInt& b) const
+  {
+    return (a >= b) ? a - b : a + (n_ - b);
+  }
+
+  /**
+   * a/2 mod n
+   */
+  BigInt half(const BigInt& a) const
+  {
+    return (a.isOdd() ? a + n_ : a) >> 1;
+  }
+
+  BigInt multiply(const BigInt& a, const BigInt& b) const
+  {
+    const auto& x = a.limbs();
+    const auto& y = b.limbs();
+    const auto& n = n_.limbs();
+    std::vector<std::uint32_t> t(size_ + 2, 0);
+
+    for (std::size_t i = 0; i < size_; ++i)
+    {
+      // t += a * b[i]
+      const std::uint64_t yi = i < y.size() ? y[i] : 0;
+      std::uint64_t carry = 0;
+      for (std::size_t j = 0; j < size_; ++j)
+      {
+        carry += (j < x.size() ? x[j] : 0) * yi + t[j];
+        t[j] = static_cast<std::uint32_t>(carry);
+        carry >>= 32;
+      }
+      carry += t[size_];
+      t[size_] = static_cast<std::uint32_t>(carry);
+      t[size_ + 1] = static_cast<std::uint32_t>(carry >> 32);
+
+      // t = (t + m * n) / 2^32 where m makes the low limb zero
+      const std::uint64_t m = static_cast<std::uint32_t>(t[0] * inverse_);
+      carry = (m * n[0] + t[0]) >> 32;
+      for (std::size_t j = 1; j < size_; ++j)
+      {
+        carry += m * n[j] + t[j];
+        t[j - 1] = static_cast<std::uint32_t>(carry);
+        carry >>= 32;
+      }
+      carry += t[size_];
+      t[size_ - 1] = static_cast<std::uint32_t>(carry);
+      t[size_] = t[size_ + 1] + static_cast<std::uint32_t>(carry >> 32);
+    }
+
+    t.pop_back();
+    auto result = BigInt::fromLimbs(std::move(t));
+    if (result >= n_)
+    {
+      result -= n_;
+    }
+    return result;
+  }
+
+  BigInt power(const BigInt& base, const BigInt& exponent) const
+  {
+    auto result = one_;
+    for (auto i = exponent.bitLength(); i-- > 0;)
+    {
+      result = multiply(result, result);
+      if (exponent.bit(i))
+      {
+        result = multiply(result, base);
+      }
+    }
+    return result;
+  }
+
+private:
+  BigInt n_;
+  std::size_t size_;
+  std::uint32_t inverse_;
+  BigInt one_;
+  BigInt r2_;
+};
+
+/**
+ * Jacobi symbol (a/n) for an odd n > 0.
+ */
+int jacobi(std::uint64_t a, std::uint64_t n) noexcept
+{
+  int result = 1;
+  a %= n;
+  while (a != 0)
+  {
+    const auto twos = std::countr_zero(a);
+    a >>= twos;
+    if ((twos & 1) != 0 && (n % 8 == 3 || n % 8 == 5))
+    {
+      result = -result;
+    }
+    if (a % 4 == 3 && n % 4 == 3)
+    {
+      result = -result;
+    }
+    std::swap(a, n);
+    a %= n;
+  }
+  return (n == 1) ? result : 0;
+}
+
+/**
+ * Jacobi symbol (d/n) for a small odd d and an odd wide n, by reciprocity it is (n mod |d| / |d|)
+ * up to sign.
+ */
+int jacobi(long long d, const BigInt& n)
+{
+  const auto nMod4 = n.modSmall(4);
+  int result = (d < 0 && nMod4 == 3) ? -1 : 1;
+  const auto m = static_cast<std::uint32_t>(d < 0 ? -d : d);
+  if (m % 4 == 3 && nMod4 == 3)
+  {
+    result = -result;
+  }
+  return result * jacobi(n.modSmall(m), m);
+}
+
+/**
+ * Strong Lucas probable prime test with P = 1 and Q = (1 - D)/4, the sequences are evaluated
+ * with the doubling formulas on the bits of d where n + 1 = d*2^s.
+ */
+bool isStrongLucasProbablePrime(const BigMontgomery& mont, long long discriminant)
+{
+  const auto fromSigned = [&](long long value) {
+    const auto a = mont.toMontgomery(BigInt(static_cast<std::uint64_t>(value < 0 ? -value : value)));
+    return (value < 0) ? mont.subtract(BigInt(), a) : a;
+  };
+  const auto D = fromSigned(discriminant);
+  const auto Q = fromSigned((1 - discriminant) / 4);
+
+  auto d = mont.modulus() + BigInt(1);
+  const auto s = trailingZeros(d);
+  d >>= static_cast<std::size_t>(s);
+
+  // U_1 = 1, V_1 = P = 1
+  auto U = mont.one();
+  auto V = mont.one();
+  auto Qk = Q;
+  for (auto i = d.bitLength() - 1; i-- > 0;)
+  {
+    // U_2k = U_k V_k, V_2k = V_k^2 - 2Q^k
+    U = mont.multiply(U, V);
+    V = mont.subtract(mont.multiply(V, V), mont.add(Qk, Qk));
+    Qk = mont.multiply(Qk, Qk);
+
+    if (d.bit(i))
+    {
+      // U_k+1 = (P U_k + V_k)/2, V_k+1 = (D U_k + P V_k)/2
+      const auto u = mont.half(mont.add(U, V));
+      V = mont.half(mont.add(mont.multiply(D, U), V));
+      U = u;
+      Qk = mont.multiply(Qk, Q);
+    }
+  }
+
+  if (U.isZero() || V.isZero())
+  {
+    return true;
+  }
+  for (int r = 1; r < s; ++r)
+  {
+    V = mont.subtract(mont.multiply(V, V), mont.add(Qk, Qk));
+    if (V.isZero())
+    {
+      return true;
+    }
+    Qk = mont.multiply(Qk, Qk);
+  }
+  return false;
+}
+
+/**
+ * Baillie-PSW, a strong base 2 Miller-Rabin test followed by a strong Lucas test with Selfridge's
+ * choice of D. No composite is known to pass both. Numbers that fit in 64 bits are handed to the
+ * deterministic isPrime().
+ */
+bool isProbablePrime(const BigInt& n)
+{
+  if (n.bitLength() <= 64)
+  {
+    return isPrime(n.toUint64());
+  }
+
+  for (std::uint32_t p : {2u, 3u, 5u, 7u, 11u, 13u, 17u, 19u, 23u, 29u, 31u, 37u, 41u, 43u, 47u})
+  {
+    if (n.modSmall(p) == 0)
+    {
+      return false;
+    }
+  }
+
+  const BigMontgomery mont(n);
+  if (!isStrongProbablePrime(mont, BigInt(2)))
+  {
+    return false;
+  }
+
+  // a square has no D with (D/n) = -1
+  const auto root = squareRoot(n);
+  if (root * root == n)
+  {
+    return false;
+  }
+
+  long long discriminant = 5;
+  for (;;)
+  {
+    const auto j = jacobi(discriminant, n);
+    if (j == -1)
+    {
+      break;
+    }
+    if (j == 0)
+    {
+      return false; // |D| < n shares a factor with n
+    }
+    discriminant = (discriminant > 0) ? -(discriminant + 2) : -(discriminant - 2);
+  }
+  return isStrongLucasProbablePrime(mont, discriminant);
+}
+
+//////////////////////////////////////////////////////////////////
+// next and previous prime
+//////////////////////////////////////////////////////////////////
+
+/**
+ * Odd numbers in a window of nextPrime()/prevPrime(). The average gap near 2^64 is 44, so one
+ * window nearly always holds the answer for 64-bit numbers.
+ */
+constexpr std::size_t primeWindow = 128;
+
+using WindowSurvivors = std::array<std::uint64_t, primeWindow / 64>;
+
+/**
+ * Clear the bits of the odd multiples of p in the window starting at low, r = low mod p.
+ */
+inline void strikeMultiples(WindowSurvivors& survivors, std::uint64_t r, std::uint32_t p) noexcept
+{
+  // low + 2i = 0 mod p for i = -r/2, (p + 1) / 2 is the inverse of 2
+  for (auto i = static_cast<std::size_t>((p - r) * ((p + 1) / 2) % p); i < primeWindow; i += p)
+  {
+    survivors[i / 64] &= ~(1ull << (i % 64));
+  }
+}
+
+/**
+ * The odd primes that sieve a 64-bit window. As compile time constants every low % p below is a
+ * multiplication instead of a division.
+ */
+constexpr std::array<std::uint32_t, 48> windowPrimes{
+  3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97,
+  101, 103, 107, 109, 113, 127, 131, 137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223, 227};
+
+template <std::size_t... K>
+void sieveWindow(std::uint64_t low, WindowSurvivors& survivors, std::index_sequence<K...>) noexcept
+{
+  (strikeMultiples(survivors, low % windowPrimes[K], windowPrimes[K]), ...);
+}
+
+/**
+ * Bit i is set when low + 2i (low odd) has no small prime factor: the windowPrimes for 64 bits,
+ * the odd table primes 3..primes[4 * bits] for wider numbers where a survivor costs more to test.
+ * Callers keep low above the square of those primes so no prime is struck out.
+ */
+template <typename T>
+WindowSurvivors sieveWindow(const T& low, const std::vector<long long>& primes)
+{
+  WindowSurvivors survivors;
+  survivors.fill(~0ull);
+  if constexpr (std::is_same_v<T, BigInt>)
+  {
+    for (std::size_t k = 1; k <= 4 * low.bitLength() && k < primes.size(); ++k)
+    {
+      const auto p = static_cast<std::uint32_t>(primes[k]);
+      strikeMultiples(survivors, low.modSmall(p), p);
+    }
+  }
+  else
+  {
+    sieveWindow(low, survivors, std::make_index_sequence<windowPrimes.size()>());
+  }
+  return survivors;
+}
+
+/**
+ * The first prime among the odd numbers from 'from' on, upwards or downwards, a window at a time:
+ * the window is sieved with small primes and only the survivors get a primality test.
+ * There must be such a prime and no window may reach down to the sieving primes.
+ */
+template <typename T>
+T searchPrime(T from, bool upwards, const std::vector<long long>& primes)
+{
+  constexpr auto span = static_cast<std::uint64_t>(2 * primeWindow);
+  auto low = upwards ? from : from - T(span - 2);
+  for (;; upwards ? low += T(span) : low -= T(span))
+  {
+    auto survivors = sieveWindow(low, primes);
+    for (std::size_t word = 0; word < survivors.size(); ++word)
+    {
+      auto& bits = survivors[upwards ? word : survivors.size() - 1 - word];
+      while (bits != 0)
+      {
+        const auto bit = upwards ? std::countr_zero(bits) : 63 - std::countl_zero(bits);
+        bits &= ~(1ull << bit);
+        const auto index = static_cast<std::uint64_t>(&bits - survivors.data()) * 64 + bit;
+        auto candidate = low + T(2 * index);
+        if constexpr (std::is_same_v<T, BigInt>)
+        {
+          if (isProbablePrime(candidate))
+          {
+            return candidate;
+          }
+        }
+        else if (isPrime(candidate))
+        {
+          return candidate;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Below this nextPrime() and prevPrime() step through the odd numbers with isPrime(), above it
+ * a window is sieved first. It keeps the windows clear of the square of the largest windowPrime.
+ */
+constexpr std::uint64_t smallPrimeSteps = 1 << 16;
+
+/**
+ * Smallest prime > x, nullopt above the largest 64-bit prime.
+ */
+std::optional<std::uint64_t> nextPrime(std::uint64_t x, const std::vector<long long>& primes)
+{
+  if (x < 2)
+  {
+    return 2;
+  }
+  if (x >= 18446744073709551557ull)
+  {
+    return std::nullopt;
+  }
+  if (x < smallPrimeSteps)
+  {
+    auto n = static_cast<std::uint32_t>((x + 1) | 1);
+    while (!isPrime(n))
+    {
+      n += 2;
+    }
+    return n;
+  }
+  return searchPrime<std::uint64_t>((x + 1) | 1, true, primes);
+}
+
+/**
+ * Largest prime < x, nullopt for x <= 2.
+ */
+std::optional<std::uint64_t> prevPrime(std::uint64_t x, const std::vector<long long>& primes)
+{
+  if (x <= 3)
+  {
+    return x == 3 ? std::optional<std::uint64_t>(2) : std::nullopt;
+  }
+  if (x <= smallPrimeSteps)
+  {
+    auto n = static_cast<std::uint32_t>((x - 2) | 1);
+    while (n > 2 && !isPrime(n))
+    {
+      n -= 2;
+    }
+    return n;
+  }
+  return searchPrime<std::uint64_t>((x - 2) | 1, false, primes);
+}
+
+/**
+ * Smallest prime > x for any width, Baillie-PSW on the window survivors once past 64 bits.
+ */
+BigInt nextPrime(const BigInt& x, const std::vector<long long>& primes)
+{
+  if (x.bitLength() <= 64)
+  {
+    if (const auto p = nextPrime(x.toUint64(), primes))
+    {
+      return *p;
+    }
+  }
+  return searchPrime(x.isOdd() ? x + BigInt(2) : x + BigInt(1), true, primes);
+}
+
+/**
+ * Largest prime < x for any width, throws for x <= 2.
+ */
+BigInt prevPrime(const BigInt& x, const std::vector<long long>& primes)
+{
+  if (x.bitLength() <= 64)
+  {
+    const auto p = prevPrime(x.toUint64(), primes);
+    if (!p)
+    {
+      throw std::invalid_argument("there is no prime below " + x.toString());
+    }
+    return *p;
+  }
+  return searchPrime(x.isOdd() ? x - BigInt(2) : x - BigInt(1), false, primes);
+}
+
+/**
+ * Greatest common divisor, Euclid.
+ */
+BigInt gcd(BigInt a, BigInt b)
+{
+  while (!b.isZero())
+  {
+    auto r = a % b;
+    a = std::move(b);
+    b = std::move(r);
+  }
+  return a;
+}
+
+/**
+ * Run work(i) for every i in [0, count) on all hardware threads, indices are handed out one at
+ * a time so a few large items do not leave the other threads idle.
+ */
+template <typename Work>
+void parallelFor(std::size_t count, const Work& work)
+{
+  const auto hardware = std::max(1u, std::thread::hardware_concurrency());
+  const auto threads = std::min<std::size_t>((threadLimit != 0) ? std::min(threadLimit, hardware) : hardware, count);
+  if (threads <= 1)
+  {
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      work(i);
+    }
+    return;
+  }
+
+  std::atomic<std::size_t> next{0};
+  std::vector<std::thread> workers;
+  for (std::size_t t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([&] {
+      for (auto i = next++; i < count; i = next++)
+      {
+        work(i);
+      }
+    });
+  }
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+}
+
+/**
+ * Product tree, level 0 is the input and every node above is the product of its two children
+ * (an odd node out is carried up as is), the last level holds the product of everything. Each
+ * level is computed in parallel.
+ */
+std::vector<std::vector<BigInt>> productTree(std::vector<BigInt> leaves)
+{
+  std::vector<std::vector<BigInt>> tree;
+  tree.push_back(std::move(leaves));
+  while (tree.back().size() > 1)
+  {
+    const auto& below = tree.back();
+    std::vector<BigInt> level((below.size() + 1) / 2);
+    parallelFor(level.size(), [&](std::size_t i) {
+      level[i] = (2 * i + 1 < below.size()) ? below[2 * i] * below[2 * i + 1] : below[2 * i];
+    });
+    tree.push_back(std::move(level));
+  }
+  return tree;
+}
+
+/**
+ * Remainder tree, value mod every leaf of the product tree (mod the leaf squared if 'squared').
+ * Going down the tree keeps the remainders small, each node only reduces its parent's remainder.
+ */
+std::vector<BigInt> remainderTree(const BigInt& value, const std::vector<std::vector<BigInt>>& tree, bool squared)
+{
+  const auto modulus = [squared](const BigInt& node) { return squared ? node * node : node; };
+
+  std::vector<BigInt> remainders{value % modulus(tree.back().front())};
+  for (auto level = tree.size() - 1; level-- > 0;)
+  {
+    const auto& nodes = tree[level];
+    std::vector<BigInt> next(nodes.size());
+    parallelFor(nodes.size(), [&](std::size_t i) { next[i] = remainders[i / 2] % modulus(nodes[i]); });
+    remainders = std::move(next);
+  }
+  return remainders;
+}
+
+/**
+ * floor(n^(1/k)) by Newton iteration from above, x = ((k-1)x + n/x^(k-1))/k until it stops
+ * decreasing. n/x^(k-1) is done as repeated division so nothing can overflow.
+ */
+std::uint64_t integerRoot(std::uint64_t n, unsigned k) noexcept
+{
+  if (n < 2 || k < 2)
+  {
+    return n;
+  }
+
+  // 2^ceil(bits/k) is larger than the root
+  auto x = std::uint64_t{1} << ((static_cast<unsigned>(std::bit_width(n)) + k - 1) / k);
+  for (;;)
+  {
+    auto quotient = n;
+    for (unsigned i = 1; i < k && quotient != 0; ++i)
+    {
+      quotient /= x;
+    }
+    const auto y = ((k - 1) * x + quotient) / k;
+    if (y >= x)
+    {
+      return x;
+    }
+    x = y;
+  }
+}
+
+/**
+ * Write n as base^exponent with the largest possible exponent, {n, 1} if n is not a perfect power.
+ * Only prime exponents below the bit length of n need to be tried, a composite exponent shows up
+ * as a repeated match on the root.
+ */
+std::pair<std::uint64_t, unsigned> perfectPower(std::uint64_t n) noexcept
+{
+  unsigned exponent = 1;
+  for (auto found = true; found && n > 3;)
+  {
+    found = false;
+    for (unsigned k : {2u, 3u, 5u, 7u, 11u, 13u, 17u, 19u, 23u, 29u, 31u, 37u, 41u, 43u, 47u, 53u, 59u, 61u})
+    {
+      if (k >= static_cast<unsigned>(std::bit_width(n)))
+      {
+        break;
+      }
+
+      const auto root = integerRoot(n, k);
+      auto power = root;
+      for (unsigned i = 1; i < k; ++i)
+      {
+        power *= root; // root^k <= n so this cannot overflow
+      }
+      if (power == n)
+      {
+        n = root;
+        exponent *= k;
+        found = true;
+        break;
+      }
+    }
+  }
+  return std::make_pair(n, exponent);
+}
+
+/**
+ * Given a number, calculate the prime numbers in it.
+ *
+ * Trial division stops as soon as the rest is known to be prime, either because the next prime
+ * squared is larger than the rest or because isPrime() says so. Whatever is left when the table
+ * runs out is added as the last factor, it is prime if it is less than the largest prime squared.
+ */
+std::vector<long long> divideWithPrimes(long long number, const std::vector<long long>& primes)
+{
+  std::vector<long long> factors;
+
+  if (number == 1)
+  {
+    factors.push_back(1);
+    return factors;
+  }
+
+  if (number > 1 && isPrime(static_cast<std::uint64_t>(number)))
+  {
+    factors.push_back(number);
+    return factors;
+  }
+
+  for (auto n : primes)
+  {
+    if (n * n > number)
+    {
+      break;
+    }
+
+    if (number % n == 0)
+    {
+      while (number % n == 0 && number != 1)
+      {
+        factors.push_back(n);
+        number /= n;
+      }
+
+      if (number > 1 && isPrime(static_cast<std::uint64_t>(number)))
+      {
+        break;
+      }
+    }
+  }
+
+  if (number > 1)
+  {
+    factors.push_back(number);
+  }
+
+  return factors;
+}
+
+//////////////////////////////////////////////////////////////////
+// budgeted factorization
+//////////////////////////////////////////////////////////////////
+
+/**
+ * Limit on the work a single continueFactorization() call may do, whichever runs out first.
+ * Operations are Pollard rho steps of two Montgomery multiplications each.
+ */
+struct FactorBudget
+{
+  std::uint64_t operations = std::numeric_limits<std::uint64_t>::max();
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+  // no limit when 'limit' is zero
+  static FactorBudget fromTimeLimit(std::chrono::milliseconds limit) noexcept
+  {
+    FactorBudget budget;
+    if (limit.count() > 0)
+    {
+      budget.deadline = std::chrono::steady_clock::now() + limit;
+    }
+    return budget;
+  }
+};
+
+/**
+ * A factorization in progress. 'factors' holds the primes found so far and 'composites' the
+ * cofactors still to be split, each with the state of its Pollard-Brent rho walk, so a call
+ * that runs out of budget can be resumed later by passing the same object back.
+ */
+struct Factorization
+{
+  struct Composite
+  {
+    std::uint64_t n;
+    long long exponent;
+    std::uint64_t c = 1; // walk x -> x^2 + c
+    std::uint64_t x = 0; // x and y are in Montgomery form
+    std::uint64_t y = 0;
+    std::uint64_t r = 1; // x is y as it was after r steps, r a power of 2
+    std::uint64_t k = 0; // steps since then
+    std::uint64_t steps = 0; // total spent on this cofactor
+  };
+
+  std::map<long long, long long> factors;
+  std::vector<Composite> composites;
+
+  bool complete() const noexcept
+  {
+    return composites.empty();
+  }
+
+  bool isComposite(long long n) const noexcept
+  {
+    return std::any_of(composites.begin(), composites.end(), [&](const Composite& c) {
+      return c.n == static_cast<std::uint64_t>(n);
+    });
+  }
+
+  // the prime factors and the unsplit composites in one map
+  std::map<long long, long long> allFactors() const
+  {
+    auto all = factors;
+    for (const auto& composite : composites)
+    {
+      all[static_cast<long long>(composite.n)] += composite.exponent;
+    }
+    return all;
+  }
+};
+
+/**
+ * Record n^exponent, as a prime factor or as a composite still to be split.
+ */
+void addCofactor(Factorization& state, std::uint64_t n, long long exponent)
+{
+  const auto [base, power] = perfectPower(n);
+  if (base == 1 || isPrime(base))
+  {
+    state.factors[static_cast<long long>(base)] += exponent * power;
+  }
+  else
+  {
+    state.composites.push_back({base, exponent * power});
+  }
+}
+
+/**
+ * Trial division with the prime table, whatever it leaves that is not prime becomes a composite
+ * for continueFactorization().
+ */
+Factorization startFactorization(long long number, const std::vector<long long>& primes)
+{
+  Factorization state;
+  if (number <= 1)
+  {
+    state.factors[number] = 1;
+    return state;
+  }
+
+  // p^k with a large p would run through the whole prime table, factorize p instead
+  const auto [base, exponent] = perfectPower(static_cast<std::uint64_t>(number));
+  if (trace && exponent > 1)
+  {
+    std::cout << "perfect power " << base << "^" << exponent << std::endl;
+  }
+
+  const auto factors = divideWithPrimes(static_cast<long long>(base), primes);
+  for (std::size_t i = 0; i + 1 < factors.size(); ++i)
+  {
+    state.factors[factors[i]] += exponent;
+  }
+  addCofactor(state, static_cast<std::uint64_t>(factors.back()), exponent);
+  return state;
+}
+
+/**
+ * Split the composites with Pollard rho in Brent's form, a gcd per batch of steps rather than per
+ * step. Returns true when the factorization is complete and false when the budget ran out, in
+ * which case 'state' holds the partial result and can be passed in again to carry on.
+ */
+bool continueFactorization(Factorization& state, const FactorBudget& budget)
+{
+  constexpr std::uint64_t batch = 128; // rho steps per gcd
+  auto operations = budget.operations;
+
+  while (!state.composites.empty())
+  {
+    auto& job = state.composites.back();
+    const Montgomery<std::uint64_t> mont(job.n);
+    const auto c = mont.toMontgomery(job.c);
+    const auto step = [&](std::uint64_t v) { return mont.add(mont.multiply(v, v), c); };
+
+    std::uint64_t divisor = 1;
+    while (divisor == 1)
+    {
+      if (operations == 0 || std::chrono::steady_clock::now() >= budget.deadline)
+      {
+        return false;
+      }
+      if (job.k == job.r)
+      {
+        job.x = job.y;
+        job.r *= 2;
+        job.k = 0;
+      }
+
+      const auto steps = std::min({batch, job.r - job.k, operations});
+      auto y = job.y;
+      auto product = mont.one();
+      for (std::uint64_t i = 0; i < steps; ++i)
+      {
+        y = step(y);
+        product = mont.multiply(product, mont.subtract(job.x, y));
+      }
+      operations -= steps;
+      job.steps += steps;
+
+      divisor = std::gcd(product, job.n);
+      if (divisor == 1)
+      {
+        job.y = y;
+        job.k += steps;
+        continue;
+      }
+
+      // somewhere in this batch, find the step one gcd at a time
+      y = job.y;
+      do
+      {
+        y = step(y);
+        divisor = std::gcd(mont.subtract(job.x, y), job.n);
+      } while (divisor == 1);
+
+      if (divisor == job.n) // the walk closed its cycle mod every factor at once, try another one
+      {
+        ++job.c;
+        job.x = job.y = 0;
+        job.r = 1;
+        job.k = 0;
+        divisor = 1;
+        break;
+      }
+    }
+    if (divisor == 1)
+    {
+      continue;
+    }
+
+    if (trace)
+    {
+      std::cout << "rho split " << job.n << " = " << divisor << " * " << job.n / divisor << " after " << job.steps
+                << " steps" << std::endl;
+    }
+    const auto n = job.n;
+    const auto exponent = job.exponent;
+    state.composites.pop_back();
+    addCofactor(state, divisor, exponent);
+    addCofactor(state, n / divisor, exponent);
+  }
+  return true;
+}
+
+/**
+ * Convert a decimal value to int e.g. 0.25 --> 1/4
+ */
+
+bool extractNumeratorDenominator(std::string line, long long& numerator, long long& denominator)
+{
+  bool ok = true;
+  try
+  {
+    const auto pos = line.find('.');
+
+    if (pos != 0 && line.length() - pos >= 9)
+    {
+      throw std::out_of_range("line too long");
+    }
+
+    int m = (pos != 0) ? std::stoi(line.substr(0, pos)) : 0; // 2.25 -> m = 2   .25 -> m = 0
+    line = line.substr(pos);
+
+    const auto len = line.length(); // .12 = 3
+
+    denominator = 1; // namnare
+    for (size_t i = 1; i < len; ++i)
+    {
+      denominator *= 10; // .12 --> 12/100
+    }
+
+    numerator = stoi(line.substr(1, len - 1)); // taljare.
+    numerator += denominator * m;
+  }
+  catch (const std::out_of_range& ex)
+  {
+    if (ex.what() != nullptr)
+    {
+      std::cout << "number has too many digits " << ex.what() << std::endl;
+    }
+    ok = false;
+  }
+  return ok;
+}
+
+/**
+ * Given factors, calculate product
+ */
+inline long long calculateProduct(std::vector<long long>& factors) noexcept
+{
+  long long n = 1;
+  for (auto i : factors)
+  {
+    n *= i;
+  }
+  return n;
+}
+
+/**
+ * Whether 'n' is a multiple of 5: n times the inverse of 5 mod 2^64 lands in [0, (2^64-1)/5]
+ * exactly for the multiples, a multiply instead of a division.
+ */
+constexpr bool divisibleBy5(std::uint64_t n) noexcept
+{
+  return n * 0xcccccccccccccccd <= std::numeric_limits<std::uint64_t>::max() / 5;
+}
+
+/**
+ * Reduce numerator/denominator where the denominator is a power of ten, so only 2 and 5 can
+ * cancel: the common 2s are the shared trailing zero bits and the common 5s are divided out
+ * one at a time, at most k of each for 10^k.
+ */
+std::pair<long long, long long> reduceDecimalFraction(long long numerator, long long denominator)
+{
+  if (numerator == 0)
+  {
+    return std::make_pair(0, 1);
+  }
+  auto magnitude = static_cast<std::uint64_t>(numerator < 0 ? -numerator : numerator);
+  auto power = static_cast<std::uint64_t>(denominator);
+
+  const auto twos = std::min(std::countr_zero(magnitude), std::countr_zero(power));
+  magnitude >>= twos;
+  power >>= twos;
+
+  auto fives = 0;
+  for (; divisibleBy5(magnitude) && divisibleBy5(power); ++fives)
+  {
+    magnitude *= 0xcccccccccccccccd; // exact division by 5
+    power *= 0xcccccccccccccccd;
+  }
+
+  if (trace)
+  {
+    std::cout << "remove the common factors, only 2 and 5 divide a power of ten" << std::endl;
+    std::cout << "  2^" << twos << " * 5^" << fives << std::endl << std::endl;
+  }
+  const auto reduced = static_cast<long long>(magnitude);
+  return std::make_pair(numerator < 0 ? -reduced : reduced, static_cast<long long>(power));
+}
+
+//////////////////////////////////////////////////////////////////
+// main functions
+//////////////////////////////////////////////////////////////////
+
+std::pair<long long, long long> decimalToFraction(const std::string& number, const bool output)
+{
+  long long numerator = 1;
+  long long denominator = 1;
+
+  // given .12 create an integer version of it, i.e. 12/100
+  if (!extractNumeratorDenominator(number, numerator, denominator))
+  {
+    return std::make_pair(0, 0);
+  }
+
+  if (trace)
+  {
+    std::cout << "remove decimal point by multiplication" << std::endl;
+    std::cout << "  " << numerator << "/" << denominator << std::endl << std::endl;
+  }
+
+  const auto [t, n] = reduceDecimalFraction(numerator, denominator);
+
+  if (output)
+  {
+    if (t > n)
+    {
+      // 9/4
+      // 9/4 = 2
+      // 9 - 2*4 = 1
+      // 2 1/4
+      std::cout << number << " = " << t << "/" << n << " ==> " << (t / n) << " " << (t - (t / n) * n) << "/"
+                << n << std::endl;
+    }
+    else
+    {
+      std::cout << number << " = " << t << "/" << n << std::endl;
+    }
+  }
+  return std::make_pair(t, n);
+}
+
+//////////////////////////////////////////////////////////////////
+
+/**
+ * A double as sign * mantissa * 2^exponent, taken from the IEEE-754 bits with no floating point
+ * arithmetic. With a negative exponent the common 2s are shifted out, so mantissa / 2^-exponent
+ * is in lowest terms. Not meaningful for infinities and NaNs, see 'finite'.
+ */
+struct DoubleParts
+{
+  bool negative;
+  bool finite;
+  std::uint64_t mantissa; // at most 53 bits, subnormals have no hidden bit
+  int exponent;
+};
+
+constexpr DoubleParts splitDouble(double value) noexcept
+{
+  const auto bits = std::bit_cast<std::uint64_t>(value);
+  const auto biased = static_cast<int>((bits >> 52) & 0x7ff);
+  auto mantissa = (bits & ((1ull << 52) - 1)) | (biased != 0 ? 1ull << 52 : 0);
+  auto exponent = std::max(biased, 1) - 1075;
+  const auto twos = std::min(std::countr_zero(mantissa | 1ull << 63), std::max(-exponent, 0));
+  mantissa >>= twos;
+  exponent = mantissa != 0 ? exponent + twos : 0;
+  return DoubleParts{.negative = (bits >> 63) != 0, .finite = biased != 0x7ff, .mantissa = mantissa, .exponent = exponent};
+}
+
+/**
+ * numerator/denominator of 'parts' when both are at most 'limit', the sign on the numerator.
+ */
+constexpr std::optional<std::pair<long long, long long>> smallFraction(const DoubleParts& parts, long long limit) noexcept
+{
+  std::uint64_t numerator = parts.mantissa;
+  std::uint64_t denominator = 1;
+  if (parts.exponent < 0 && parts.exponent >= -62)
+  {
+    denominator <<= -parts.exponent;
+  }
+  else if (parts.exponent < 0 || std::bit_width(numerator) + parts.exponent > 63)
+  {
+    return std::nullopt;
+  }
+  else
+  {
+    numerator <<= parts.exponent;
+  }
+  if (!parts.finite || numerator > static_cast<std::uint64_t>(limit) || denominator > static_cast<std::uint64_t>(limit))
+  {
+    return std::nullopt;
+  }
+  const auto n = static_cast<long long>(numerator);
+  return std::make_pair(parts.negative ? -n : n, static_cast<long long>(denominator));
+}
+
+/**
+ * The exact value of a finite double as numerator/denominator in lowest terms, no decimal string
+ * in between. The denominator is a power of two, at most 2^1074.
+ */
+struct DoubleFraction
+{
+  bool negative;
+  BigInt numerator;
+  BigInt denominator;
+};
+
+DoubleFraction doubleToFraction(double value)
+{
+  const auto parts = splitDouble(value);
+  if (!parts.finite)
+  {
+    throw std::invalid_argument("not a finite number");
+  }
+  return DoubleFraction{
+    .negative = parts.negative && parts.mantissa != 0,
+    .numerator = BigInt(parts.mantissa) << static_cast<std::size_t>(std::max(parts.exponent, 0)),
+    .denominator = BigInt(1) << static_cast<std::size_t>(std::max(-parts.exponent, 0))};
+}
+
+/**
+ * The fraction closest to 'value' with numerator and denominator at most 'limit', the exact one
+ * when it fits. Otherwise the continued fraction of the exact value is followed until the next
+ * convergent would pass the limit, and the best of that convergent and the last semiconvergent
+ * is taken. Nullopt when |value| is larger than the limit.
+ */
+std::optional<std::pair<long long, long long>> approximateDouble(double value, long long limit)
+{
+  const auto parts = splitDouble(value);
+  if (const auto fraction = smallFraction(parts, limit); fraction || !parts.finite)
+  {
+    return fraction;
+  }
+
+  const auto [negative, numerator, denominator] = doubleToFraction(value);
+  const auto bound = static_cast<std::uint64_t>(limit);
+  const auto distance = [&](std::uint64_t n, std::uint64_t d) { // |n/d - value| * d * denominator
+    const auto a = BigInt(n) * denominator;
+    const auto b = numerator * BigInt(d);
+    return a > b ? a - b : b - a;
+  };
+
+  std::uint64_t h0 = 0, h1 = 1; // numerators of the last two convergents
+  std::uint64_t k0 = 1, k1 = 0; // denominators
+  BigInt p = numerator;
+  BigInt q = denominator;
+  while (!q.isZero())
+  {
+    BigInt a, r;
+    BigInt::divide(p, q, a, r);
+    auto t = h1 != 0 ? (bound - h0) / h1 : bound; // largest next quotient that stays within the limit
+    if (k1 != 0)
+    {
+      t = std::min(t, (bound - k0) / k1);
+    }
+    if (a.bitLength() > 64 || a.toUint64() > t)
+    {
+      if (k1 == 0)
+      {
+        return std::nullopt; // the integer part alone is over the limit
+      }
+      const auto n = h0 + t * h1;
+      const auto d = k0 + t * k1;
+      if (t != 0 && distance(n, d) * BigInt(k1) < distance(h1, k1) * BigInt(d))
+      {
+        h1 = n;
+        k1 = d;
+      }
+      break;
+    }
+    const auto quotient = a.toUint64();
+    h0 = std::exchange(h1, quotient * h1 + h0);
+    k0 = std::exchange(k1, quotient * k1 + k0);
+    p = std::move(q);
+    q = std::move(r);
+  }
+  const auto n = static_cast<long long>(h1);
+  return std::make_pair(negative ? -n : n, static_cast<long long>(k1));
+}
+
+/**
+ * approximateDouble() over an array: the bit splitting and the common case of a fraction that
+ * fits run as a flat loop over all values, only the rest take the continued fraction.
+ * A denominator of 0 means no fraction, 'exact' tells the exact ones from approximations.
+ */
+struct DoubleFractions
+{
+  std::vector<long long> numerators;
+  std::vector<long long> denominators;
+  std::vector<std::uint8_t> exact;
+};
+
+DoubleFractions doublesToFractions(const std::vector<double>& values, long long limit)
+{
+  DoubleFractions result{
+    .numerators = std::vector<long long>(values.size()),
+    .denominators = std::vector<long long>(values.size()),
+    .exact = std::vector<std::uint8_t>(values.size())};
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    const auto fraction = smallFraction(splitDouble(values[i]), limit);
+    result.numerators[i] = fraction ? fraction->first : 0;
+    result.denominators[i] = fraction ? fraction->second : 0;
+    result.exact[i] = fraction.has_value();
+  }
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    if (!result.exact[i] && std::isfinite(values[i]))
+    {
+      const auto fraction = approximateDouble(values[i], limit);
+      result.numerators[i] = fraction ? fraction->first : 0;
+      result.denominators[i] = fraction ? fraction->second : 0;
+    }
+  }
+  return result;
+}
+
+/**
+ * --double: the exact fraction of the double nearest to 'number' and, when that does not fit
+ * in 'limit', the best fraction that does.
+ */
+void printDoubleFraction(const std::string& number, long long limit)
+{
+  char* end = nullptr;
+  const auto value = std::strtod(number.c_str(), &end); // subnormals set ERANGE but are exact
+  if (number.empty() || end != number.c_str() + number.size())
+  {
+    throw std::invalid_argument("not a number '" + number + "'");
+  }
+
+  const auto [negative, numerator, denominator] = doubleToFraction(value);
+  std::cout << number << " = " << (negative ? "-" : "") << numerator.toString() << "/" << denominator.toString();
+  if (!smallFraction(splitDouble(value), limit))
+  {
+    if (const auto fraction = approximateDouble(value, limit))
+    {
+      std::cout << " ~ " << fraction->first << "/" << fraction->second;
+    }
+  }
+  std::cout << std::endl;
+
+  if (trace)
+  {
+    const auto parts = splitDouble(value);
+    std::cout << "  " << (parts.negative ? "-" : "") << parts.mantissa << " * 2^" << parts.exponent << std::endl;
+  }
+}
+
+/**
+ * --doubles: the fraction of every double in a binary file of native IEEE-754 values, "=" when
+ * exact and "~" for the best one within 'limit'. batchChunk values at a time.
+ */
+void batchDoubles(const std::string& fileName, long long limit)
+{
+  std::ifstream in(fileName, std::ios::binary);
+  if (!in)
+  {
+    throw std::runtime_error("cannot open '" + fileName + "'");
+  }
+
+  std::vector<double> values(batchChunk);
+  while (in)
+  {
+    in.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(double)));
+    values.resize(static_cast<std::size_t>(in.gcount()) / sizeof(double));
+    const auto fractions = doublesToFractions(values, limit);
+
+    fmt::memory_buffer out;
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+      if (fractions.denominators[i] == 0)
+      {
+        fmt::format_to(std::back_inserter(out), "{} has no fraction\n", values[i]);
+      }
+      else
+      {
+        fmt::format_to(
+          std::back_inserter(out), "{} {} {}/{}\n", values[i], fractions.exact[i] ? '=' : '~',
+          fractions.numerators[i], fractions.denominators[i]);
+      }
+    }
+    std::fwrite(out.data(), 1, out.size(), stdout);
+  }
+  std::fflush(stdout);
+}
+
+//////////////////////////////////////////////////////////////////
+// persistent factor cache
+//////////////////////////////////////////////////////////////////
+
+/**
+ * A file mapped into memory read and write, shared with every other process that maps it.
+ */
+class MappedFile
+{
+public:
+  MappedFile(const std::string& fileName, std::size_t size)
+    : size_(size)
+  {
+#if defined(_WIN32)
+    const auto file = CreateFileA(
+      fileName.c_str(),
+      GENERIC_READ | GENERIC_WRITE,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+      nullptr,
+      OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL,
+      nullptr);
+    const auto mapping =
+      (file == INVALID_HANDLE_VALUE) ? nullptr : CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    data_ = (mapping == nullptr) ? nullptr : MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (mapping != nullptr)
+    {
+      CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE)
+    {
+      CloseHandle(file);
+    }
+#else
+    const auto file = ::open(fileName.c_str(), O_RDWR);
+    data_ = (file < 0) ? MAP_FAILED : ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (file >= 0)
+    {
+      ::close(file);
+    }
+    if (data_ == MAP_FAILED)
+    {
+      data_ = nullptr;
+    }
+#endif
+    if (data_ == nullptr)
+    {
+      throw std::runtime_error("cannot map '" + fileName + "'");
+    }
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile()
+  {
+#if defined(_WIN32)
+    UnmapViewOfFile(data_);
+#else
+    ::munmap(data_, size_);
+#endif
+  }
+
+  void* data() const noexcept
+  {
+    return data_;
+  }
+
+private:
+  void* data_ = nullptr;
+  std::size_t size_;
+};
+
+/**
+ * Factorizations kept across runs in an open addressing hash table in a --cache file, keyed by
+ * the number. A slot is claimed by swapping its key in from 0, then the factors are written and
+ * last a check word that hashes the key and the factors. Readers take a slot only when the check
+ * matches, so a write torn by a crash or still in progress in another process reads as a miss
+ * and is written again by the next insert of that number. When the probes find no room the
+ * factors are simply not kept.
+ *
+ * The factors of n are coded in 48 bytes: a byte with the length of the list of all but the
+ * largest prime, each as a 7-bit varint and a byte exponent, and then the exponent e of the
+ * largest prime, which is the e-th root of what is left of n. n < 2^63 has at most 15 distinct
+ * primes and the list needs 38 bytes at the most.
+ */
+class FactorCache
+{
+public:
+  FactorCache(const std::string& fileName, std::size_t bytes)
+    : slots_(create(fileName, bytes))
+    , file_(fileName, (slots_ + 1) * sizeof(Slot))
+    , table_(static_cast<Slot*>(file_.data()) + 1)
+  {
+  }
+
+  std::optional<std::map<long long, long long>> find(std::uint64_t n) const
+  {
+    for (auto i = 0; i < probes; ++i)
+    {
+      auto& slot = table_[(home(n) + i) & (slots_ - 1)];
+      const auto key = std::atomic_ref(slot.key).load(std::memory_order_acquire);
+      if (key == 0)
+      {
+        break;
+      }
+      if (key == n)
+      {
+        const auto check = std::atomic_ref(slot.check).load(std::memory_order_acquire);
+        std::array<std::uint64_t, 6> words;
+        for (std::size_t w = 0; w < words.size(); ++w)
+        {
+          words[w] = std::atomic_ref(slot.words[w]).load(std::memory_order_relaxed);
+        }
+        if (check != hash(n, words))
+        {
+          break;
+        }
+        ++hits;
+        return decode(n, words);
+      }
+    }
+    ++misses;
+    return std::nullopt;
+  }
+
+  void insert(std::uint64_t n, const std::map<long long, long long>& factors)
+  {
+    const auto words = encode(factors);
+    if (!words)
+    {
+      return;
+    }
+    for (auto i = 0; i < probes; ++i)
+    {
+      auto& slot = table_[(home(n) + i) & (slots_ - 1)];
+      std::uint64_t key = 0;
+      if (std::atomic_ref(slot.key).compare_exchange_strong(key, n, std::memory_order_acq_rel) || key == n)
+      {
+        for (std::size_t w = 0; w < words->size(); ++w)
+        {
+          std::atomic_ref(slot.words[w]).store((*words)[w], std::memory_order_relaxed);
+        }
+        std::atomic_ref(slot.check).store(hash(n, *words), std::memory_order_release);
+        return;
+      }
+    }
+  }
+
+  mutable std::atomic<std::uint64_t> hits{0};
+  mutable std::atomic<std::uint64_t> misses{0};
+
+private:
+  struct Slot
+  {
+    std::uint64_t key; // 0 when free
+    std::uint64_t check; // 0 until the factors are written
+    std::uint64_t words[6];
+  };
+  static_assert(sizeof(Slot) == 64);
+
+  static constexpr std::uint64_t magic = 0x3145484341435250; // "PRCACHE1"
+  static constexpr int probes = 16;
+
+  /**
+   * Create the file unless it is there and return its number of slots. A new file is set up
+   * under a temporary name and linked in place, so a process that loses the race to create it
+   * uses the other one. Where there are no hard links it is renamed in place instead. Either
+   * way the file has to fit in --max-memory, it is mapped whole.
+   */
+  static std::size_t create(const std::string& fileName, std::size_t bytes)
+  {
+    if (!std::filesystem::exists(fileName))
+    {
+      const auto slots = std::bit_floor(std::max<std::size_t>(bytes / sizeof(Slot), 1024));
+      checkMemory(static_cast<double>((slots + 1) * sizeof(Slot)), "the --cache file");
+      const auto temporary = fmt::format("{}.{}", fileName, std::random_device{}());
+      {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        const std::array<std::uint64_t, 2> header{magic, slots};
+        out.write(reinterpret_cast<const char*>(header.data()), sizeof(header));
+        if (!out)
+        {
+          throw std::runtime_error("cannot write '" + temporary + "'");
+        }
+      }
+      std::filesystem::resize_file(temporary, (slots + 1) * sizeof(Slot));
+      std::error_code error;
+      std::filesystem::create_hard_link(temporary, fileName, error);
+      if (error && !std::filesystem::exists(fileName))
+      {
+        // no hard links on this file system, the rename may replace a file created meanwhile by
+        // another process, which then keeps using its own
+        error.clear();
+        std::filesystem::rename(temporary, fileName, error);
+      }
+      std::filesystem::remove(temporary);
+      if (error && !std::filesystem::exists(fileName))
+      {
+        throw std::runtime_error("cannot create '" + fileName + "': " + error.message());
+      }
+    }
+
+    std::array<std::uint64_t, 2> header{};
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in.read(reinterpret_cast<char*>(header.data()), sizeof(header)) || header[0] != magic
+        || !std::has_single_bit(header[1]) || std::filesystem::file_size(fileName) != (header[1] + 1) * sizeof(Slot))
+    {
+      throw std::runtime_error("'" + fileName + "' is not a factor cache");
+    }
+    checkMemory(static_cast<double>((header[1] + 1) * sizeof(Slot)), "the --cache file");
+    return static_cast<std::size_t>(header[1]);
+  }
+
+  std::size_t home(std::uint64_t n) const noexcept
+  {
+    return static_cast<std::size_t>((n * 0x9e3779b97f4a7c15) >> 32);
+  }
+
+  static std::uint64_t hash(std::uint64_t n, const std::array<std::uint64_t, 6>& words) noexcept
+  {
+    auto h = n ^ 0x9e3779b97f4a7c15;
+    for (const auto w : words)
+    {
+      h = (h ^ w) * 0xff51afd7ed558ccd;
+      h ^= h >> 32;
+    }
+    return h | 1;
+  }
+
+  static std::optional<std::array<std::uint64_t, 6>> encode(const std::map<long long, long long>& factors)
+  {
+    std::array<std::uint8_t, 48> code{};
+    std::size_t length = 1;
+    for (auto it = factors.begin(); std::next(it) != factors.end(); ++it)
+    {
+      for (auto p = static_cast<std::uint64_t>(it->first); length < code.size(); p >>= 7)
+      {
+        code[length++] = static_cast<std::uint8_t>((p & 0x7f) | (p >= 0x80 ? 0x80 : 0));
+        if (p < 0x80)
+        {
+          break;
+        }
+      }
+      if (length + 2 > code.size())
+      {
+        return std::nullopt;
+      }
+      code[length++] = static_cast<std::uint8_t>(it->second);
+    }
+    code[0] = static_cast<std::uint8_t>(length - 1);
+    code[length] = static_cast<std::uint8_t>(factors.rbegin()->second);
+
+    std::array<std::uint64_t, 6> words;
+    std::memcpy(words.data(), code.data(), code.size());
+    return words;
+  }
+
+  static std::map<long long, long long> decode(std::uint64_t n, const std::array<std::uint64_t, 6>& words)
+  {
+    std::array<std::uint8_t, 48> code;
+    std::memcpy(code.data(), words.data(), code.size());
+
+    std::map<long long, long long> factors;
+    const std::size_t end = code[0] + 1u;
+    for (std::size_t i = 1; i < end;)
+    {
+      std::uint64_t p = 0;
+      for (unsigned shift = 0;; shift += 7)
+      {
+        p |= std::uint64_t{code[i] & 0x7fu} << shift;
+        if ((code[i++] & 0x80) == 0)
+        {
+          break;
+        }
+      }
+      const auto exponent = code[i++];
+      factors[static_cast<long long>(p)] = exponent;
+      for (auto e = 0; e < exponent; ++e)
+      {
+        n /= p;
+      }
+    }
+    factors[static_cast<long long>(integerRoot(n, code[end]))] = code[end];
+    return factors;
+  }
+
+  std::size_t slots_;
+  MappedFile file_;
+  Slot* table_;
+};
+
+/**
+ * Open the --cache file once all the arguments are read, a new one gets at most a quarter of
+ * --max-memory. 'factorCache' points to it for as long as the returned owner lives, shared_ptr
+ * because main() only sees the declaration of FactorCache.
+ */
+std::shared_ptr<FactorCache> openFactorCache()
+{
+  if (factorCacheFile.empty())
+  {
+    return nullptr;
+  }
+  if (memoryBudget != 0)
+  {
+    factorCacheSize = std::min(factorCacheSize, memoryBudget / 4);
+  }
+  auto cache = std::make_shared<FactorCache>(factorCacheFile, factorCacheSize);
+  factorCache = cache.get();
+  return cache;
+}
+
+//////////////////////////////////////////////////////////////////
+// columnar output
+//////////////////////////////////////////////////////////////////
+
+/**
+ * Just enough of a FlatBuffers builder for the Arrow metadata. Like the real one it builds from
+ * the back, so a table is written after everything it points to, and a Ref is the distance of an
+ * object from the end of the buffer. Metadata is a few hundred bytes, the buffer simply grows at
+ * the front.
+ */
+class FlatBuilder
+{
+public:
+  using Ref = std::size_t;
+
+  template <typename T>
+  Ref scalar(T value)
+  {
+    align(sizeof(T), sizeof(T));
+    prepend(&value, sizeof(T));
+    return data_.size();
+  }
+
+  Ref offset(Ref target)
+  {
+    align(4, 4);
+    return scalar(static_cast<std::uint32_t>(data_.size() + 4 - target));
+  }
+
+  Ref string(std::string_view text)
+  {
+    align(text.size() + 1, 4);
+    data_.insert(data_.begin(), 0);
+    prepend(text.data(), text.size());
+    return scalar(static_cast<std::uint32_t>(text.size()));
+  }
+
+  // a vector of structs
+  template <typename T>
+  Ref structs(const std::vector<T>& items)
+  {
+    align(items.size() * sizeof(T), std::max<std::size_t>(alignof(T), 4));
+    prepend(items.data(), items.size() * sizeof(T));
+    return scalar(static_cast<std::uint32_t>(items.size()));
+  }
+
+  // a vector of tables
+  Ref tables(const std::vector<Ref>& items)
+  {
+    for (auto it = items.rbegin(); it != items.rend(); ++it)
+    {
+      offset(*it);
+    }
+    return scalar(static_cast<std::uint32_t>(items.size()));
+  }
+
+  void startTable()
+  {
+    fields_.clear();
+    start_ = data_.size();
+  }
+
+  template <typename T>
+  void field(std::uint16_t id, T value)
+  {
+    fields_.emplace_back(id, scalar(value));
+  }
+
+  void fieldOffset(std::uint16_t id, Ref target)
+  {
+    fields_.emplace_back(id, offset(target));
+  }
+
+  /**
+   * The table starts with the distance back to its vtable, which is written right in front of it:
+   * the size of the vtable and of the table and the position of each field in the table.
+   */
+  Ref endTable()
+  {
+    const auto table = scalar(std::int32_t{0});
+    std::vector<std::uint16_t> vtable(2, 0);
+    for (const auto& [id, at] : fields_)
+    {
+      vtable.resize(std::max<std::size_t>(vtable.size(), id + 3u), 0);
+      vtable[id + 2u] = static_cast<std::uint16_t>(table - at);
+    }
+    vtable[0] = static_cast<std::uint16_t>(vtable.size() * sizeof(std::uint16_t));
+    vtable[1] = static_cast<std::uint16_t>(table - start_);
+    prepend(vtable.data(), vtable.size() * sizeof(std::uint16_t));
+    const auto distance = static_cast<std::int32_t>(data_.size() - table);
+    std::memcpy(data_.data() + data_.size() - table, &distance, sizeof(distance));
+    return table;
+  }
+
+  // the buffer with 'root' as its root table, a multiple of 8 bytes
+  std::vector<std::uint8_t> finish(Ref root)
+  {
+    align(4, 8);
+    offset(root);
+    return std::move(data_);
+  }
+
+private:
+  // pad so that 'bytes' more end up a multiple of 'alignment' from the end
+  void align(std::size_t bytes, std::size_t alignment)
+  {
+    data_.insert(data_.begin(), (alignment - (data_.size() + bytes) % alignment) % alignment, 0);
+  }
+
+  void prepend(const void* data, std::size_t bytes)
+  {
+    const auto* first = static_cast<const std::uint8_t*>(data);
+    data_.insert(data_.begin(), first, first + bytes);
+  }
+
+  std::vector<std::uint8_t> data_;
+  std::vector<std::pair<std::uint16_t, Ref>> fields_;
+  Ref start_ = 0;
+};
+
+/**
+ * --batch with --output: the factorizations in an Arrow IPC file, written without the Arrow
+ * library. The schema is
+ * value: int64, factors: list<struct<prime: int64, exponent: uint8, composite: bool>>,
+ * so a record batch holds the values, one offsets array into the factors and the flat prime,
+ * exponent and composite columns, none of them with nulls. A factor the --budget left unsplit
+ * is in the prime column with composite set. Every chunk of the batch becomes a record batch.
+ */
+class ArrowWriter
+{
+public:
+  explicit ArrowWriter(const std::string& fileName)
+    : fileName_(fileName)
+    , out_(fileName, std::ios::binary | std::ios::trunc)
+  {
+    out_.write("ARROW1\0\0", 8);
+    FlatBuilder builder;
+    const auto schema = addSchema(builder);
+    writeMessage(builder, schemaHeader, schema, {});
+  }
+
+  void write(const std::vector<long long>& values, const std::vector<Factorization>& results)
+  {
+    std::vector<std::int32_t> offsets{0};
+    std::vector<std::int64_t> primes;
+    std::vector<std::uint8_t> exponents;
+    std::vector<std::uint8_t> composites; // bitmap, least significant bit first
+    for (const auto& result : results)
+    {
+      for (const auto& [p, exponent] : result.allFactors())
+      {
+        if (primes.size() % 8 == 0)
+        {
+          composites.push_back(0);
+        }
+        if (result.isComposite(p))
+        {
+          composites.back() |= static_cast<std::uint8_t>(1 << (primes.size() % 8));
+        }
+        primes.push_back(p);
+        exponents.push_back(static_cast<std::uint8_t>(exponent));
+      }
+      if (primes.size() > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()))
+      {
+        throw std::out_of_range("batch for an Arrow record batch, please lower --max-memory");
+      }
+      offsets.push_back(static_cast<std::int32_t>(primes.size()));
+    }
+
+    // each buffer starts at a multiple of 8 in the body, validity buffers are empty without nulls
+    std::vector<std::uint8_t> body;
+    std::vector<Buffer> buffers;
+    const auto addBuffer = [&](const void* data, std::size_t bytes) {
+      buffers.push_back(
+        {.offset = static_cast<std::int64_t>(body.size()), .length = static_cast<std::int64_t>(bytes)});
+      body.insert(body.end(), static_cast<const std::uint8_t*>(data), static_cast<const std::uint8_t*>(data) + bytes);
+      body.resize((body.size() + 7) / 8 * 8, 0);
+    };
+    addBuffer(nullptr, 0);
+    addBuffer(values.data(), values.size() * sizeof(long long));
+    addBuffer(nullptr, 0);
+    addBuffer(offsets.data(), offsets.size() * sizeof(std::int32_t));
+    addBuffer(nullptr, 0);
+    addBuffer(nullptr, 0);
+    addBuffer(primes.data(), primes.size() * sizeof(std::int64_t));
+    addBuffer(nullptr, 0);
+    addBuffer(exponents.data(), exponents.size());
+    addBuffer(nullptr, 0);
+    addBuffer(composites.data(), composites.size());
+
+    const auto rows = static_cast<std::int64_t>(values.size());
+    const auto factors = static_cast<std::int64_t>(primes.size());
+    const std::vector<FieldNode> nodes{
+      {rows, 0}, {rows, 0}, {factors, 0}, {factors, 0}, {factors, 0}, {factors, 0}};
+
+    FlatBuilder builder;
+    const auto nodesRef = builder.structs(nodes);
+    const auto buffersRef = builder.structs(buffers);
+    builder.startTable();
+    builder.field(0, rows);
+    builder.fieldOffset(1, nodesRef);
+    builder.fieldOffset(2, buffersRef);
+    const auto batch = builder.endTable();
+    blocks_.push_back(writeMessage(builder, recordBatchHeader, batch, body));
+  }
+
+  /**
+   * End of stream, then the footer with the schema again and where the record batches are.
+   */
+  void close()
+  {
+    const std::array<std::uint32_t, 2> end{0xffffffff, 0};
+    out_.write(reinterpret_cast<const char*>(end.data()), sizeof(end));
+
+    FlatBuilder builder;
+    const auto schema = addSchema(builder);
+    const auto dictionaries = builder.structs(std::vector<Block>{});
+    const auto batches = builder.structs(blocks_);
+    builder.startTable();
+    builder.field(0, metadataVersion);
+    builder.fieldOffset(1, schema);
+    builder.fieldOffset(2, dictionaries);
+    builder.fieldOffset(3, batches);
+    const auto footer = builder.finish(builder.endTable());
+    const auto length = static_cast<std::int32_t>(footer.size());
+    out_.write(reinterpret_cast<const char*>(footer.data()), length);
+    out_.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    out_.write("ARROW1", 6);
+    if (!out_.flush())
+    {
+      throw std::runtime_error("cannot write '" + fileName_ + "'");
+    }
+  }
+
+private:
+  struct FieldNode
+  {
+    std::int64_t length;
+    std::int64_t nullCount;
+  };
+
+  struct Buffer
+  {
+    std::int64_t offset;
+    std::int64_t length;
+  };
+
+  struct Block
+  {
+    std::int64_t offset;
+    std::int32_t metadataLength;
+    std::int32_t unused;
+    std::int64_t bodyLength;
+  };
+
+  static constexpr std::int16_t metadataVersion = 4; // V5
+
+  // union type ids of Type and MessageHeader
+  static constexpr std::uint8_t intType = 2;
+  static constexpr std::uint8_t boolType = 6;
+  static constexpr std::uint8_t listType = 12;
+  static constexpr std::uint8_t structType = 13;
+  static constexpr std::uint8_t schemaHeader = 1;
+  static constexpr std::uint8_t recordBatchHeader = 3;
+
+  static FlatBuilder::Ref addSchema(FlatBuilder& builder)
+  {
+    const auto addInt = [&](std::int32_t bits, bool isSigned) {
+      builder.startTable();
+      builder.field(0, bits);
+      builder.field(1, static_cast<std::uint8_t>(isSigned));
+      return builder.endTable();
+    };
+    const auto addEmpty = [&] {
+      builder.startTable();
+      return builder.endTable();
+    };
+    const auto addField = [&](
+                            std::string_view name,
+                            std::uint8_t typeType,
+                            FlatBuilder::Ref type,
+                            const std::vector<FlatBuilder::Ref>& children) {
+      const auto nameRef = builder.string(name);
+      const auto childrenRef = builder.tables(children);
+      builder.startTable();
+      builder.fieldOffset(0, nameRef);
+      builder.field(1, std::uint8_t{0}); // not nullable
+      builder.field(2, typeType);
+      builder.fieldOffset(3, type);
+      builder.fieldOffset(5, childrenRef);
+      return builder.endTable();
+    };
+
+    const auto prime = addField("prime", intType, addInt(64, true), {});
+    const auto exponent = addField("exponent", intType, addInt(8, false), {});
+    const auto composite = addField("composite", boolType, addEmpty(), {});
+    const auto item = addField("item", structType, addEmpty(), {prime, exponent, composite});
+    const auto factors = addField("factors", listType, addEmpty(), {item});
+    const auto value = addField("value", intType, addInt(64, true), {});
+    const auto fields = builder.tables({value, factors});
+    builder.startTable();
+    builder.field(0, static_cast<std::int16_t>(std::endian::native == std::endian::little ? 0 : 1));
+    builder.fieldOffset(1, fields);
+    return builder.endTable();
+  }
+
+  /**
+   * A message is 0xffffffff, the length of its metadata, the metadata padded to 8 bytes and the
+   * body. Returns where it is for the footer.
+   */
+  Block writeMessage(
+    FlatBuilder& builder,
+    std::uint8_t headerType,
+    FlatBuilder::Ref header,
+    const std::vector<std::uint8_t>& body)
+  {
+    builder.startTable();
+    builder.field(0, metadataVersion);
+    builder.field(1, headerType);
+    builder.fieldOffset(2, header);
+    builder.field(3, static_cast<std::int64_t>(body.size()));
+    const auto metadata = builder.finish(builder.endTable());
+
+    const Block block{
+      .offset = static_cast<std::int64_t>(out_.tellp()),
+      .metadataLength = static_cast<std::int32_t>(metadata.size() + 8),
+      .unused = 0,
+      .bodyLength = static_cast<std::int64_t>(body.size())};
+    const std::array<std::int32_t, 2> prefix{-1, static_cast<std::int32_t>(metadata.size())};
+    out_.write(reinterpret_cast<const char*>(prefix.data()), sizeof(prefix));
+    out_.write(reinterpret_cast<const char*>(metadata.data()), static_cast<std::streamsize>(metadata.size()));
+    out_.write(reinterpret_cast<const char*>(body.data()), static_cast<std::streamsize>(body.size()));
+    return block;
+  }
+
+  std::string fileName_;
+  std::ofstream out_;
+  std::vector<Block> blocks_;
+};
+
+//////////////////////////////////////////////////////////////////
+
+/**
+ * Write 'value' in decimal at 'out' and return the end, two digits per step from a table of the
+ * pairs 00..99 and no locale or format string to look at.
+ */
+char* writeDecimal(char* out, std::uint64_t value) noexcept
+{
+  static constexpr char pairs[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                                  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                                  "8081828384858687888990919293949596979899";
+  char digits[20];
+  auto* first = digits + sizeof(digits);
+  while (value >= 100)
+  {
+    const auto pair = static_cast<std::size_t>(value % 100) * 2;
+    value /= 100;
+    *--first = pairs[pair + 1];
+    *--first = pairs[pair];
+  }
+  if (value >= 10)
+  {
+    *--first = pairs[value * 2 + 1];
+    *--first = pairs[value * 2];
+  }
+  else
+  {
+    *--first = static_cast<char>('0' + value);
+  }
+  return std::copy(first, digits + sizeof(digits), out);
+}
+
+/**
+ * The escapes fmt::print(fg(color), ...) puts before and after its text, taken from fmt once
+ * so that a record can be colored without a call per token.
+ */
+struct ColorEscape
+{
+  std::string before;
+  std::string after;
+
+  explicit ColorEscape(fmt::color color)
+  {
+    const auto marked = fmt::format(fg(color), "\x01");
+    const auto mark = marked.find('\x01');
+    before = marked.substr(0, mark);
+    after = marked.substr(mark + 1);
+  }
+};
+
+/**
+ * Append the record "m = p^e*q*..." to 'out' the way fmt::print(fg(...)) colors it, a whole
+ * factorization at a time rather than a call per token. The composites the --budget left are
+ * marked. 'm' is in decimal, and a wide number's 'cofactor' that did not fit in a long long
+ * comes last when it is not empty.
+ */
+void appendFactorization(
+  fmt::memory_buffer& out,
+  std::string_view m,
+  const Factorization& factorization,
+  std::string_view cofactor = {},
+  bool cofactorComposite = false)
+{
+  static const ColorEscape white(fmt::color::white);
+  static const ColorEscape red(fmt::color::red);
+  static const ColorEscape yellow(fmt::color::yellow);
+  static const ColorEscape gray(fmt::color::gray);
+  const auto append = [&](std::string_view text) { out.append(text.data(), text.data() + text.size()); };
+  const auto appendColored = [&](const ColorEscape& color, std::string_view text) {
+    append(color.before);
+    append(text);
+    append(color.after);
+  };
+  char digits[24];
+  const auto appendNumber = [&](const ColorEscape& color, long long value) {
+    appendColored(color, {digits, writeDecimal(digits, static_cast<std::uint64_t>(value))});
+  };
+
+  // "\n" << std::setw(10) << m << " = "
+  out.push_back('\n');
+  for (auto width = m.size(); width < 10; ++width)
+  {
+    out.push_back(' ');
+  }
+  append(m);
+  append(" = ");
+
+  auto count = 0; // number of factors printed
+  for (auto n : factorization.allFactors())
+  {
+    if (count++ > 0)
+    {
+      appendColored(gray, "*");
+    }
+
+    appendNumber(white, n.first);
+    if (n.second != 1)
+    {
+      appendColored(red, "^");
+      appendNumber(yellow, n.second);
+    }
+
+    if (factorization.isComposite(n.first))
+    {
+      appendColored(gray, " (composite)");
+    }
+  }
+
+  if (!cofactor.empty())
+  {
+    if (count > 0)
+    {
+      appendColored(gray, "*");
+    }
+    appendColored(white, cofactor);
+    if (cofactorComposite)
+    {
+      appendColored(gray, " (composite)");
+    }
+  }
+  out.push_back('\n');
+}
+
+void appendFactorization(fmt::memory_buffer& out, long long m, const Factorization& factorization)
+{
+  char digits[24];
+  appendFactorization(out, {digits, writeDecimal(digits, static_cast<std::uint64_t>(m))}, factorization);
+}
+
+/**
+ * Print "m = p^e*q*..." the way factorizeNumber() does.
+ */
+void printFactorization(long long m, const Factorization& factorization)
+{
+  fmt::memory_buffer out;
+  appendFactorization(out, m, factorization);
+  std::fwrite(out.data(), 1, out.size(), stdout);
+  std::fflush(stdout);
+}
+
+/**
+ * Factorize m, from the --cache when it has m and within the --budget, what the budget leaves
+ * unsplit is in 'composites'.
+ */
+Factorization factorize(long long m, const std::vector<long long>& primes)
+{
+  auto* const cache = (m >= 2) ? factorCache : nullptr;
+  if (auto cached = cache ? cache->find(static_cast<std::uint64_t>(m)) : std::nullopt)
+  {
+    Factorization state;
+    state.factors = std::move(*cached);
+    return state;
+  }
+
+  auto state = startFactorization(m, primes);
+  if (!continueFactorization(state, FactorBudget::fromTimeLimit(factorTimeLimit)) && trace)
+  {
+    std::cout << "budget exhausted with " << state.composites.size() << " composite(s) left" << std::endl;
+  }
+  if (cache && state.complete())
+  {
+    cache->insert(static_cast<std::uint64_t>(m), state.factors);
+  }
+  return state;
+}
+
+std::map<long long, long long> factorizeNumber(long long m, const std::vector<long long>& primes, const bool output)
+{
+  const auto state = factorize(m, primes);
+  if (output)
+  {
+    printFactorization(m, state);
+  }
+
+  // what the budget leaves unsplit is returned as a composite factor
+  return state.allFactors();
+}
+
+std::map<long long, long long> factorizeNumber(const std::string& number, const std::vector<long long>& primes, const bool output)
+{
+  return factorizeNumber(std::stoll(number), primes, output);
+}
+
+/**
+ * Factorize a number that does not fit in a long long. The prime table divides out the small
+ * factors, what is left is stored in 'cofactor' and is 1 when the number was fully factored.
+ * A cofactor that fails isProbablePrime() is printed as composite.
+ */
+std::map<long long, long long> factorizeWideNumber(
+  const std::string& number,
+  const std::vector<long long>& primes,
+  const bool output,
+  BigInt* cofactor)
+{
+  auto rest = BigInt::fromString(number);
+  std::map<long long, long long> factorsWithExp;
+
+  if (!isProbablePrime(rest))
+  {
+    for (auto n : primes)
+    {
+      const auto p = static_cast<std::uint32_t>(n);
+      if (rest.modSmall(p) != 0)
+      {
+        continue;
+      }
+
+      do
+      {
+        rest.divideSmall(p);
+        factorsWithExp[n]++;
+      } while (rest.modSmall(p) == 0);
+
+      // once it fits, the 64-bit path finishes the job and what the budget leaves stays in 'rest'
+      if (rest.bitLength() < 63)
+      {
+        auto state = startFactorization(static_cast<long long>(rest.toUint64()), primes);
+        continueFactorization(state, FactorBudget::fromTimeLimit(factorTimeLimit));
+        rest = BigInt(1);
+        for (const auto& [p, e] : state.factors)
+        {
+          if (p != 1)
+          {
+            factorsWithExp[p] += e;
+          }
+        }
+        for (const auto& composite : state.composites)
+        {
+          for (auto e = composite.exponent; e > 0; --e)
+          {
+            rest *= BigInt(composite.n);
+          }
+        }
+        break;
+      }
+      if (isProbablePrime(rest))
+      {
+        break;
+      }
+    }
+  }
+
+  if (output)
+  {
+    Factorization factorization;
+    factorization.factors = factorsWithExp;
+    const auto wide = rest != BigInt(1);
+    fmt::memory_buffer out;
+    appendFactorization(
+      out, number, factorization, wide ? rest.toString() : std::string(), wide && !isProbablePrime(rest));
+    std::fwrite(out.data(), 1, out.size(), stdout);
+    std::fflush(stdout);
+  }
+
+  if (cofactor != nullptr)
+  {
+    *cofactor = rest;
+  }
+  return factorsWithExp;
+}
+
+//////////////////////////////////////////////////////////////////
+
+/**
+ * Read the next decimal number, one per line, blank lines are skipped. False at the end.
+ */
+bool readNumber(std::istream& in, BigInt& n)
+{
+  std::string line;
+  while (std::getline(in, line))
+  {
+    const auto first = line.find_first_not_of(" \t\r");
+    if (first != std::string::npos)
+    {
+      n = BigInt::fromString(line.substr(first, line.find_last_not_of(" \t\r") + 1 - first));
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<BigInt> readNumbers(const std::string& fileName)
+{
+  std::ifstream in(fileName);
+  if (!in)
+  {
+    throw std::runtime_error("cannot open '" + fileName + "'");
+  }
+
+  std::vector<BigInt> numbers;
+  for (BigInt n; readNumber(in, n);)
+  {
+    numbers.push_back(n);
+  }
+  return numbers;
+}
+
+/**
+ * Bytes in a product tree over 'leaves', every level holds about as many bits as the leaves.
+ */
+double treeBytes(const std::vector<BigInt>& leaves)
+{
+  double bits = 0;
+  for (const auto& n : leaves)
+  {
+    bits += static_cast<double>(n.bitLength()) + 32;
+  }
+  return bits / 8 * (std::bit_width(leaves.size()) + 1);
+}
+
+/**
+ * Batch GCD (Bernstein): for every modulus N in the file find the gcd of N and the product of all
+ * the others. With P the product of all moduli that is gcd(N, (P mod N^2) / N), so one product
+ * tree and one remainder tree replace the pairwise gcds. Moduli sharing a factor are printed as
+ * N = g * N/g, when g = N all of N's factors also occur elsewhere (e.g. duplicates).
+ */
+void batchGcd(const std::string& fileName)
+{
+  const auto start = std::chrono::steady_clock::now();
+  const auto moduli = readNumbers(fileName);
+  if (std::any_of(moduli.begin(), moduli.end(), [](const BigInt& n) { return n <= BigInt(1); }))
+  {
+    throw std::invalid_argument("moduli must be larger than 1");
+  }
+  if (moduli.size() < 2)
+  {
+    return;
+  }
+  checkMemory(3 * treeBytes(moduli), "the product and remainder trees"); // the remainder tree is mod N^2
+
+  const auto tree = productTree(moduli);
+  const auto remainders = remainderTree(tree.back().front(), tree, true);
+
+  std::vector<BigInt> shared(moduli.size());
+  parallelFor(moduli.size(), [&](std::size_t i) { shared[i] = gcd(moduli[i], remainders[i] / moduli[i]); });
+
+  std::size_t found = 0;
+  for (std::size_t i = 0; i < moduli.size(); ++i)
+  {
+    if (shared[i] == BigInt(1))
+    {
+      continue;
+    }
+
+    ++found;
+    if (shared[i] == moduli[i])
+    {
+      fmt::print("{} shares all its factors\n", moduli[i].toString());
+    }
+    else
+    {
+      fmt::print("{} = {} * {}\n", moduli[i].toString(), shared[i].toString(), (moduli[i] / shared[i]).toString());
+    }
+  }
+
+  if (trace)
+  {
+    const auto stop = std::chrono::steady_clock::now();
+    std::cout << found << " of " << moduli.size() << " moduli share a factor, product tree of "
+              << tree.size() << " levels, " << tree.back().front().bitLength() << " bits, took "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << " ms"
+              << std::endl;
+  }
+}
+
+//////////////////////////////////////////////////////////////////
+
+/**
+ * Batch smoothness (Bernstein): which numbers in the file factor completely over the table primes
+ * up to 'bound' (0 for the whole table), and what their smooth part is. With P the product of those primes n is smooth
+ * iff P^(2^e) mod n = 0 for 2^e >= bits of n, and gcd(n, P^(2^e) mod n) is the smooth part.
+ * P mod n for all numbers at once comes out of one remainder tree instead of trial division.
+ */
+void batchSmoothness(const std::string& fileName, const std::vector<long long>& primes, long long bound)
+{
+  const auto start = std::chrono::steady_clock::now();
+  const auto numbers = readNumbers(fileName);
+  if (std::any_of(numbers.begin(), numbers.end(), [](const BigInt& n) { return n.isZero(); }))
+  {
+    throw std::invalid_argument("numbers must be larger than 0");
+  }
+  if (numbers.empty())
+  {
+    return;
+  }
+  if (bound > primes.back())
+  {
+    std::cerr << "smoothness bound limited to the largest table prime " << primes.back() << std::endl;
+  }
+  if (bound <= 0 || bound > primes.back())
+  {
+    bound = primes.back();
+  }
+  // the prime product has about 1.44 bits per unit of 'bound'
+  checkMemory(2 * treeBytes(numbers) + static_cast<double>(bound) * 1.44 / 8 * 3, "the product and remainder trees");
+
+  std::vector<BigInt> base;
+  for (auto p : primes)
+  {
+    if (p > bound)
+    {
+      break;
+    }
+    base.emplace_back(static_cast<std::uint64_t>(p));
+  }
+  const auto product = base.empty() ? BigInt(1) : productTree(std::move(base)).back().front();
+  const auto remainders = remainderTree(product, productTree(numbers), false);
+
+  std::vector<BigInt> smoothPart(numbers.size());
+  parallelFor(numbers.size(), [&](std::size_t i) {
+    auto y = remainders[i];
+    for (std::size_t bits = 1; bits < numbers[i].bitLength(); bits <<= 1)
+    {
+      y = (y * y) % numbers[i];
+    }
+    smoothPart[i] = gcd(numbers[i], y);
+  });
+
+  std::size_t smooth = 0;
+  for (std::size_t i = 0; i < numbers.size(); ++i)
+  {
+    if (smoothPart[i] == numbers[i])
+    {
+      ++smooth;
+      fmt::print("{} is {}-smooth\n", numbers[i].toString(), bound);
+    }
+    else
+    {
+      fmt::print("{} = {} * {}\n", numbers[i].toString(), smoothPart[i].toString(), (numbers[i] / smoothPart[i]).toString());
+    }
+  }
+
+  if (trace)
+  {
+    const auto stop = std::chrono::steady_clock::now();
+    std::cout << smooth << " of " << numbers.size() << " numbers are " << bound << "-smooth, prime product of "
+              << product.bitLength() << " bits, took "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << " ms" << std::endl;
+  }
+}
+
+//////////////////////////////////////////////////////////////////
+
+/**
+ * LSD radix sort of (value, index) pairs by value, a byte per pass. Passes where every value has
+ * the same byte are skipped, so small values only cost a pass or two.
+ */
+void radixSort(std::vector<std::pair<std::uint64_t, std::uint32_t>>& items)
+{
+  std::vector<std::pair<std::uint64_t, std::uint32_t>> buffer(items.size());
+  for (int shift = 0; shift < 64; shift += 8)
+  {
+    std::size_t offsets[257] = {};
+    for (const auto& item : items)
+    {
+      ++offsets[((item.first >> shift) & 0xff) + 1];
+    }
+    if (std::any_of(std::begin(offsets), std::end(offsets), [&](std::size_t n) { return n == items.size(); }))
+    {
+      continue;
+    }
+    std::partial_sum(std::begin(offsets), std::end(offsets), std::begin(offsets));
+    for (const auto& item : items)
+    {
+      buffer[offsets[(item.first >> shift) & 0xff]++] = item;
+    }
+    items.swap(buffer);
+  }
+}
+
+/**
+ * Eight bytes from 'p' as a word, the first byte in the low bits whatever the byte order.
+ */
+std::uint64_t loadWord(const char* p) noexcept
+{
+  if constexpr (std::endian::native == std::endian::little)
+  {
+    std::uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+  }
+  std::uint64_t word = 0;
+  for (int i = 7; i >= 0; --i)
+  {
+    word = word << 8 | static_cast<unsigned char>(p[i]);
+  }
+  return word;
+}
+
+/**
+ * First '\n' in [first, last) or last, eight bytes per step: a byte of word ^ 0x0a..0a is zero
+ * exactly where the newline is and (x - 0x01..01) & ~x & 0x80..80 flags the lowest zero byte.
+ */
+const char* findNewline(const char* first, const char* last) noexcept
+{
+  constexpr std::uint64_t ones = 0x0101010101010101;
+  for (; last - first >= 8; first += 8)
+  {
+    const auto word = loadWord(first) ^ (ones * '\n');
+    const auto zeros = (word - ones) & ~word & (ones * 0x80);
+    if (zeros != 0)
+    {
+      return first + std::countr_zero(zeros) / 8;
+    }
+  }
+  return std::find(first, last, '\n');
+}
+
+/**
+ * Value of the eight ASCII digits at 'p' (SWAR): the digits are combined pairwise into four
+ * 2-digit, two 4-digit and one 8-digit lane with three multiplies. Nullopt if any byte is not a digit.
+ */
+std::optional<std::uint32_t> parseEightDigits(const char* p) noexcept
+{
+  constexpr std::uint64_t ones = 0x0101010101010101;
+  const auto word = loadWord(p) - ones * '0';
+  if (((word + ones * (0x7f - 9)) | word) & (ones * 0x80))
+  {
+    return std::nullopt;
+  }
+  auto value = (word * 10 + (word >> 8)) & 0x00ff00ff00ff00ff;
+  value = (value * 100 + (value >> 16)) & 0x0000ffff0000ffff;
+  return static_cast<std::uint32_t>((value * 10000 + (value >> 32)) & 0xffffffff);
+}
+
+/**
+ * Parse one --batch line: optional blanks and sign around a decimal number between 1 and 2^63-1.
+ * Nullopt for a blank line.
+ */
+std::optional<long long> parseBatchLine(const char* first, const char* last)
+{
+  const auto isBlank = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+  while (first != last && isBlank(*first))
+  {
+    ++first;
+  }
+  while (first != last && isBlank(last[-1]))
+  {
+    --last;
+  }
+  if (first == last)
+  {
+    return std::nullopt;
+  }
+
+  const auto line = first;
+  const auto negative = *first == '-';
+  if (*first == '+' || *first == '-')
+  {
+    ++first;
+  }
+  const auto notANumber = [&] { return std::invalid_argument("not a number '" + std::string(line, last) + "'"); };
+  if (first == last)
+  {
+    throw notANumber();
+  }
+  while (last - first > 1 && *first == '0')
+  {
+    ++first;
+  }
+
+  const auto tooLarge = [&] {
+    return std::out_of_range(fmt::format(
+      "batch numbers must be between 1 and {}, not '{}'", std::numeric_limits<long long>::max(), std::string(line, last)));
+  };
+  const auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+  if (last - first > std::numeric_limits<std::uint64_t>::digits10) // 19 digits cannot wrap
+  {
+    if (!std::all_of(first, last, isDigit))
+    {
+      throw notANumber();
+    }
+    throw tooLarge();
+  }
+
+  std::uint64_t value = 0;
+  for (; last - first >= 8; first += 8)
+  {
+    const auto digits = parseEightDigits(first);
+    if (!digits)
+    {
+      throw notANumber();
+    }
+    value = value * 100'000'000 + *digits;
+  }
+  for (; first != last; ++first)
+  {
+    if (!isDigit(*first))
+    {
+      throw notANumber();
+    }
+    value = value * 10 + static_cast<std::uint64_t>(*first - '0');
+  }
+  if (negative || value == 0 || value > static_cast<std::uint64_t>(std::numeric_limits<long long>::max()))
+  {
+    throw tooLarge();
+  }
+  return static_cast<long long>(value);
+}
+
+/**
+ * Reads a --batch file in large blocks and parses the lines in place, no std::string or
+ * stream extraction per number. A line that is not a number stops it with its line number.
+ */
+class BatchReader
+{
+public:
+  explicit BatchReader(const std::string& fileName) : in(fileName, std::ios::binary), buffer(1 << 20)
+  {
+    if (!in)
+    {
+      throw std::runtime_error("cannot open '" + fileName + "'");
+    }
+  }
+
+  /**
+   * Append numbers until 'numbers' holds 'count', false once the file is exhausted.
+   */
+  bool read(std::vector<long long>& numbers, std::size_t count)
+  {
+    while (numbers.size() < count)
+    {
+      const auto* first = buffer.data() + begin;
+      const auto* last = buffer.data() + end;
+      const auto* newline = findNewline(first, last);
+      if (newline == last && !fill())
+      {
+        if (first == last)
+        {
+          return false;
+        }
+        newline = last; // the last line has no newline
+      }
+      else if (newline == last)
+      {
+        continue;
+      }
+      ++line;
+      try
+      {
+        if (const auto n = parseBatchLine(first, newline))
+        {
+          numbers.push_back(*n);
+        }
+      }
+      catch (const std::invalid_argument& ex)
+      {
+        throw std::invalid_argument(fmt::format("on line {}: {}", line, ex.what()));
+      }
+      catch (const std::out_of_range& ex)
+      {
+        throw std::out_of_range(fmt::format("on line {}: {}", line, ex.what()));
+      }
+      begin = std::min(end, static_cast<std::size_t>(newline - buffer.data()) + 1);
+    }
+    return true;
+  }
+
+private:
+  /**
+   * Move the unparsed tail to the front and read more behind it, false at the end of the file.
+   */
+  bool fill()
+  {
+    if (!in)
+    {
+      return false;
+    }
+    std::copy(buffer.begin() + static_cast<std::ptrdiff_t>(begin), buffer.begin() + static_cast<std::ptrdiff_t>(end),
+      buffer.begin());
+    end -= begin;
+    begin = 0;
+    if (end == buffer.size())
+    {
+      buffer.resize(2 * buffer.size()); // a line longer than the buffer
+    }
+    in.read(buffer.data() + end, static_cast<std::streamsize>(buffer.size() - end));
+    end += static_cast<std::size_t>(in.gcount());
+    return true;
+  }
+
+  std::ifstream in;
+  std::vector<char> buffer;
+  std::size_t begin = 0; // unparsed bytes are [begin, end)
+  std::size_t end = 0;
+  std::uint64_t line = 0; // lines parsed so far, for the errors
+};
+
+/**
+ * Factorize one chunk of a --batch file into 'results', blocks of numbers spread over the
+ * threads. With 'dedup' the chunk is radix sorted with the line indexes first, so every
+ * distinct value is factorized once and the result is scattered back to all the lines that hold
+ * it. Returns the number of factorizations it took.
+ */
+std::size_t factorizeChunk(
+  const std::vector<long long>& numbers,
+  std::vector<Factorization>& results,
+  const std::vector<long long>& primes,
+  bool dedup)
+{
+  constexpr std::size_t block = 256;
+  const auto factorizeAll = [&](std::size_t count, const auto& number, const auto& result) {
+    parallelFor((count + block - 1) / block, [&](std::size_t b) {
+      for (auto i = b * block; i < std::min(count, (b + 1) * block); ++i)
+      {
+        result(i) = factorize(number(i), primes);
+      }
+    });
+  };
+  if (!dedup)
+  {
+    factorizeAll(
+      numbers.size(), [&](std::size_t i) { return numbers[i]; }, [&](std::size_t i) -> auto& { return results[i]; });
+    return numbers.size();
+  }
+
+  std::vector<std::pair<std::uint64_t, std::uint32_t>> order(numbers.size());
+  for (std::size_t i = 0; i < numbers.size(); ++i)
+  {
+    order[i] = {static_cast<std::uint64_t>(numbers[i]), static_cast<std::uint32_t>(i)};
+  }
+  radixSort(order);
+
+  // the first line of each value
+  std::vector<std::size_t> firsts;
+  for (std::size_t i = 0; i < order.size(); ++i)
+  {
+    if (i == 0 || order[i].first != order[i - 1].first)
+    {
+      firsts.push_back(i);
+    }
+  }
+  factorizeAll(
+    firsts.size(),
+    [&](std::size_t i) { return static_cast<long long>(order[firsts[i]].first); },
+    [&](std::size_t i) -> auto& { return results[order[firsts[i]].second]; });
+  for (std::size_t i = 1, first = 0; i < order.size(); ++i)
+  {
+    if (order[i].first != order[i - 1].first)
+    {
+      first = i;
+    }
+    else
+    {
+      results[order[i].second] = results[order[first].second];
+    }
+  }
+  return firsts.size();
+}
+
+/**
+ * Factorize every number in the file (one per line) and print them in file order, or write them
+ * to the Arrow file 'outputFile' when it is given, batchChunk numbers at a time so that memory
+ * does not grow with the file.
+ */
+void batchFactorize(
+  const std::string& fileName,
+  const std::vector<long long>& primes,
+  bool dedup,
+  const std::string& outputFile)
+{
+  const auto start = std::chrono::steady_clock::now();
+  BatchReader reader(fileName);
+  std::optional<ArrowWriter> arrow;
+  if (!outputFile.empty())
+  {
+    arrow.emplace(outputFile);
+  }
+
+  std::size_t total = 0;
+  std::size_t distinct = 0;
+  std::vector<long long> numbers;
+  std::vector<Factorization> results;
+  for (auto more = true; more;)
+  {
+    numbers.clear();
+    more = reader.read(numbers, batchChunk);
+    results.assign(numbers.size(), {});
+    total += numbers.size();
+    distinct += factorizeChunk(numbers, results, primes, dedup);
+    if (arrow)
+    {
+      arrow->write(numbers, results);
+      continue;
+    }
+
+    fmt::memory_buffer out;
+    for (std::size_t i = 0; i < numbers.size(); ++i)
+    {
+      appendFactorization(out, numbers[i], results[i]);
+      if (out.size() > 64 * 1024)
+      {
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        out.clear();
+      }
+    }
+    std::fwrite(out.data(), 1, out.size(), stdout);
+  }
+  std::fflush(stdout);
+  if (arrow)
+  {
+    arrow->close();
+  }
+
+  if (trace)
+  {
+    const auto stop = std::chrono::steady_clock::now();
+    std::cout << distinct << " factorizations for " << total << " numbers, took "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << " ms" << std::endl;
+    if (const auto* cache = factorCache)
+    {
+      std::cout << cache->hits << " of them found in the cache" << std::endl;
+    }
+  }
+}
+
+
+/**
+ * nextPrime() or prevPrime() of every value, 0 where there is none. Blocks of values are spread
+ * over the threads.
+ */
+std::vector<std::uint64_t>
+  adjacentPrimes(const std::vector<std::uint64_t>& values, bool upwards, const std::vector<long long>& primes)
+{
+  constexpr std::size_t block = 4096;
+  std::vector<std::uint64_t> result(values.size());
+  parallelFor((values.size() + block - 1) / block, [&](std::size_t b) {
+    for (auto i = b * block; i < std::min(values.size(), (b + 1) * block); ++i)
+    {
+      result[i] = (upwards ? nextPrime(values[i], primes) : prevPrime(values[i], primes)).value_or(0);
+    }
+  });
+  return result;
+}
+
+/**
+ * --next/--prev with --batch: the adjacent prime of every number in the file, one per line in
+ * file order ("none" below 3 for --prev).
+ */
+void batchAdjacentPrimes(const std::string& fileName, bool upwards, const std::vector<long long>& primes)
+{
+  BatchReader reader(fileName);
+  std::vector<long long> numbers;
+  std::vector<std::uint64_t> values;
+  for (auto more = true; more;)
+  {
+    numbers.clear();
+    more = reader.read(numbers, batchChunk);
+    values.assign(numbers.begin(), numbers.end());
+
+    fmt::memory_buffer out;
+    char digits[24];
+    for (const auto p : adjacentPrimes(values, upwards, primes))
+    {
+      if (p == 0)
+      {
+        out.append(std::string_view("none"));
+      }
+      else
+      {
+        out.append(digits, writeDecimal(digits, p));
+      }
+      out.push_back('\n');
+    }
+    std::fwrite(out.data(), 1, out.size(), stdout);
+  }
+  std::fflush(stdout);
+}
+
+/**
+ * --next/--prev {n}: the prime after or before n, n of any width.
+ */
+void printAdjacentPrime(const std::string& number, bool upwards, const std::vector<long long>& primes)
+{
+  const auto x = BigInt::fromString(number);
+  const auto start = std::chrono::steady_clock::now();
+  const auto p = upwards ? nextPrime(x, primes) : prevPrime(x, primes);
+  const auto stop = std::chrono::steady_clock::now();
+  std::cout << p.toString() << std::endl;
+  if (trace)
+  {
+    std::cout << (upwards ? "next" : "previous") << " prime, took "
+              << std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count() << " us" << std::endl;
+  }
+}
+
+//////////////////////////////////////////////////////////////////
+// primitive roots and multiplicative orders
+//////////////////////////////////////////////////////////////////
+
+/**
+ * Prime factorization of 1 <= n < 2^63 as prime -> exponent, kept since order() and
+ * primitiveRoot() ask for the same p-1 over and over. Not thread safe.
+ */
+const std::map<long long, long long>& cachedFactors(long long n, const std::vector<long long>& primes)
+{
+  static std::map<long long, std::map<long long, long long>> cache;
+  if (const auto it = cache.find(n); it != cache.end())
+  {
+    return it->second;
+  }
+  if (cache.size() >= 1 << 16)
+  {
+    cache.clear();
+  }
+  auto state = startFactorization(n, primes);
+  continueFactorization(state, FactorBudget{});
+  state.factors.erase(1);
+  return cache[n] = std::move(state.factors);
+}
+
+/**
+ * Whether g generates the multiplicative group mod the prime p, i.e. g^((p-1)/q) != 1 for every
+ * prime q of p-1.
+ */
+template <typename Factors>
+bool isPrimitiveRoot(const Montgomery<std::uint64_t>& mont, std::uint64_t g, const Factors& factors) noexcept
+{
+  const auto p = mont.modulus();
+  const auto x = mont.toMontgomery(g);
+  return std::none_of(std::begin(factors), std::end(factors), [&](std::uint64_t q) {
+    return mont.power(x, (p - 1) / q) == mont.one();
+  });
+}
+
+/**
+ * Smallest primitive root of the prime p < 2^63.
+ */
+std::uint64_t primitiveRoot(std::uint64_t p, const std::vector<long long>& primes)
+{
+  if (p > static_cast<std::uint64_t>(std::numeric_limits<long long>::max()) || !isPrime(p))
+  {
+    throw std::invalid_argument("a primitive root needs a prime below 2^63");
+  }
+  if (p == 2)
+  {
+    return 1;
+  }
+
+  std::vector<std::uint64_t> factors;
+  for (const auto& [q, exponent] : cachedFactors(static_cast<long long>(p - 1), primes))
+  {
+    factors.push_back(static_cast<std::uint64_t>(q));
+  }
+  const Montgomery<std::uint64_t> mont(p);
+  std::uint64_t g = 2;
+  while (!isPrimitiveRoot(mont, g, factors))
+  {
+    ++g;
+  }
+  return g;
+}
+
+/**
+ * Multiplicative order of a mod n (gcd(a, n) = 1, n < 2^63): the lcm of the orders mod each
+ * prime power q^e of n. Mod an odd q^e the order divides phi = q^(e-1) * (q-1), every prime of
+ * phi is divided out while a^(phi/r) stays 1. Mod 2^e it is the number of squarings to reach 1.
+ */
+std::uint64_t order(std::uint64_t a, std::uint64_t n, const std::vector<long long>& primes)
+{
+  if (n == 0 || n > static_cast<std::uint64_t>(std::numeric_limits<long long>::max()) || std::gcd(a, n) != 1)
+  {
+    throw std::invalid_argument("the order of a mod n needs gcd(a, n) = 1 and 0 < n < 2^63");
+  }
+
+  std::uint64_t result = 1;
+  for (const auto& [prime, exponent] : cachedFactors(static_cast<long long>(n), primes))
+  {
+    const auto q = static_cast<std::uint64_t>(prime);
+    std::uint64_t power = 1;
+    for (long long i = 0; i < exponent; ++i)
+    {
+      power *= q;
+    }
+
+    std::uint64_t t = 1;
+    if (q == 2)
+    {
+      for (auto x = a & (power - 1); x != 1; x = x * x & (power - 1))
+      {
+        t *= 2;
+      }
+    }
+    else
+    {
+      const Montgomery<std::uint64_t> mont(power);
+      const auto x = mont.toMontgomery(a);
+      t = power / q * (q - 1);
+      std::vector<std::uint64_t> divisors{q};
+      for (const auto& [r, e] : cachedFactors(static_cast<long long>(q - 1), primes))
+      {
+        divisors.push_back(static_cast<std::uint64_t>(r));
+      }
+      for (const auto r : divisors)
+      {
+        while (t % r == 0 && mont.power(x, t / r) == mont.one())
+        {
+          t /= r;
+        }
+      }
+    }
+    result = std::lcm(result, t);
+  }
+  return result;
+}
+
+/**
+ * Smallest primitive root of every prime in [low, high) as onRoot(p, g). The p-1 of a sieve
+ * segment are factorized together: the interval is sieved with the primes up to sqrt(high),
+ * each hit on a p-1 records that prime, and what is left after them is one more prime.
+ */
+template <typename OnRoot>
+void primitiveRoots(std::uint64_t low, std::uint64_t high, const OnRoot& onRoot)
+{
+  if (high > static_cast<std::uint64_t>(std::numeric_limits<long long>::max()))
+  {
+    throw std::out_of_range("primitive roots need primes below 2^63");
+  }
+  const auto root = static_cast<std::uint64_t>(std::sqrt(static_cast<double>(high))) + 1;
+  const auto rootBytes = static_cast<double>(root) / std::log(static_cast<double>(root) + 2) * 1.3 * 4;
+  checkMemory(rootBytes, "the sieving primes");
+  std::vector<std::uint32_t> base;
+  sievePrimes(2, root + 1, [&](std::uint64_t q) { base.push_back(static_cast<std::uint32_t>(q)); });
+
+  constexpr std::size_t maxFactors = 15; // 2*3*5*...*47 > 2^63
+  std::vector<std::uint64_t> segment;     // the primes of the segment
+  std::vector<std::int32_t> slot;         // p-1 at from-1+i belongs to segment[slot[i]], -1 for no prime
+  std::vector<std::uint64_t> rest;        // p-1 without the sieving primes
+  std::vector<std::array<std::uint64_t, maxFactors + 1>> factors;
+  std::vector<std::uint8_t> counts;
+  low = std::max<std::uint64_t>(low, 2);
+  auto from = low;
+  const auto onSegment = [&](std::uint64_t to) {
+    slot.assign(static_cast<std::size_t>(to - from), -1);
+    rest.resize(segment.size());
+    factors.resize(segment.size());
+    counts.assign(segment.size(), 0);
+    for (std::size_t k = 0; k < segment.size(); ++k)
+    {
+      slot[segment[k] - from] = static_cast<std::int32_t>(k);
+      rest[k] = segment[k] - 1;
+    }
+
+    for (const std::uint64_t q : base)
+    {
+      for (auto i = (q - (from - 1) % q) % q; i < slot.size(); i += q)
+      {
+        if (const auto k = slot[i]; k >= 0)
+        {
+          factors[k][counts[k]++] = q;
+          do
+          {
+            rest[k] /= q;
+          } while (rest[k] % q == 0);
+        }
+      }
+    }
+
+    for (std::size_t k = 0; k < segment.size(); ++k)
+    {
+      const auto p = segment[k];
+      if (rest[k] > 1)
+      {
+        factors[k][counts[k]++] = rest[k];
+      }
+      if (p == 2)
+      {
+        onRoot(p, std::uint64_t{1});
+        continue;
+      }
+      const Montgomery<std::uint64_t> mont(p);
+      const auto known = std::span(factors[k].data(), counts[k]);
+      std::uint64_t g = 2;
+      while (!isPrimitiveRoot(mont, g, known))
+      {
+        ++g;
+      }
+      onRoot(p, g);
+    }
+    segment.clear();
+    from = to;
+  };
+  sievePrimes(low, high, [&](std::uint64_t p) { segment.push_back(p); }, onSegment);
+  if (!segment.empty())
+  {
+    onSegment(high); // only 2, there was no odd segment
+  }
+}
+
+/**
+ * --roots: every prime in [low, high] with its smallest primitive root, "p g" per line.
+ */
+void printPrimitiveRoots(std::uint64_t low, std::uint64_t high)
+{
+  const auto start = std::chrono::steady_clock::now();
+  fmt::memory_buffer out;
+  char digits[24];
+  std::uint64_t count = 0;
+  primitiveRoots(low, high + 1, [&](std::uint64_t p, std::uint64_t g) {
+    out.append(digits, writeDecimal(digits, p));
+    out.push_back(' ');
+    out.append(digits, writeDecimal(digits, g));
+    out.push_back('\n');
+    ++count;
+    if (out.size() > 64 * 1024)
+    {
+      std::fwrite(out.data(), 1, out.size(), stdout);
+      out.clear();
+    }
+  });
+  std::fwrite(out.data(), 1, out.size(), stdout);
+  std::fflush(stdout);
+
+  if (trace)
+  {
+    const auto stop = std::chrono::steady_clock::now();
+    std::cout << count << " primitive roots, took "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << " ms" << std::endl;
+  }
+}
+
+//////////////////////////////////////////////////////////////////
+// aliquot sequences
+//////////////////////////////////////////////////////////////////
+
+/**
+ * s(n) = sigma(n) - n, the sum of the proper divisors of 0 < n < 2^63, from the factorization:
+ * sigma(n) is the product of 1 + p + ... + p^e over the p^e of n. Nullopt when s(n) needs more
+ * than 63 bits.
+ */
+std::optional<std::uint64_t> aliquotSum(std::uint64_t n, const std::vector<long long>& primes)
+{
+  if (n == 1)
+  {
+    return 0;
+  }
+  auto state = startFactorization(static_cast<long long>(n), primes);
+  continueFactorization(state, FactorBudget{});
+
+  std::uint64_t sigma = 1;
+  for (const auto& [prime, exponent] : state.factors)
+  {
+    const auto p = static_cast<std::uint64_t>(prime);
+    std::uint64_t sum = 1;
+    std::uint64_t hi = 0;
+    for (long long e = 0; e < exponent && hi == 0; ++e)
+    {
+      sum = wideMultiply(sum, p, hi) + 1;
+    }
+    sigma = (hi == 0) ? wideMultiply(sigma, sum, hi) : 0;
+    if (hi != 0)
+    {
+      return std::nullopt;
+    }
+  }
+  if (sigma - n > static_cast<std::uint64_t>(std::numeric_limits<long long>::max()))
+  {
+    return std::nullopt;
+  }
+  return sigma - n;
+}
+
+/**
+ * One aliquot sequence n, s(n), s(s(n)), ... as far as it got, terms[0] is the start.
+ */
+struct AliquotSequence
+{
+  std::vector<std::uint64_t> terms;
+  std::string end; // why it stopped, empty while it is open
+
+  /**
+   * Take up to 'steps' more steps. It ends at 1 (s(1) = 0), in a cycle (perfect, amicable or
+   * sociable numbers) or when a term passes 2^63. 'next' is s(n), 'onTerm' sees every new term.
+   */
+  template <typename Next, typename OnTerm>
+  void run(std::size_t steps, const Next& next, const OnTerm& onTerm)
+  {
+    std::map<std::uint64_t, std::size_t> seen;
+    for (std::size_t i = 0; i < terms.size(); ++i)
+    {
+      seen.emplace(terms[i], i);
+    }
+    while (end.empty())
+    {
+      if (terms.back() == 1)
+      {
+        end = "terminates";
+      }
+      else if (seen.size() < terms.size())
+      {
+        const auto first = seen[terms.back()];
+        end = fmt::format("cycle of length {}", terms.size() - 1 - first);
+      }
+      else if (steps-- == 0)
+      {
+        break;
+      }
+      else if (const auto term = next(terms.back()))
+      {
+        terms.push_back(*term);
+        seen.emplace(*term, terms.size() - 1);
+        onTerm(terms.size() - 1, *term);
+      }
+      else
+      {
+        end = "exceeds 2^63";
+      }
+    }
+  }
+};
+
+/**
+ * The sequences recorded in an aliquot log, "prime aliquot 1" and then "start index term" per
+ * line in the order they were found. A truncated last line is ignored, 'length' is where the
+ * complete lines end.
+ */
+std::map<std::uint64_t, AliquotSequence> loadAliquotLog(const std::string& fileName, std::uintmax_t& length)
+{
+  std::ifstream in(fileName);
+  std::string line;
+  if (!std::getline(in, line) || line != "prime aliquot 1")
+  {
+    throw std::runtime_error("cannot read aliquot log '" + fileName + "'");
+  }
+
+  std::map<std::uint64_t, AliquotSequence> sequences;
+  length = static_cast<std::uintmax_t>(in.tellg());
+  while (std::getline(in, line) && !in.eof()) // no newline after a line cut short
+  {
+    std::istringstream fields(line);
+    std::uint64_t start = 0;
+    std::size_t index = 0;
+    std::uint64_t term = 0;
+    if (!(fields >> start >> index >> term))
+    {
+      break;
+    }
+    length = static_cast<std::uintmax_t>(in.tellg());
+    auto& terms = sequences[start].terms;
+    if (terms.empty())
+    {
+      terms.push_back(start);
+    }
+    if (index == terms.size())
+    {
+      terms.push_back(term);
+    }
+  }
+  return sequences;
+}
+
+/**
+ * --aliquot: run the sequences from 'starts' (and with 'resume' those in the log) up to 'steps'
+ * more steps each, in parallel. Every term goes to the log file when there is one, flushed at
+ * the checkpoint interval. The values of s(n) are shared between the sequences since many of
+ * them merge.
+ */
+void runAliquotSequences(
+  std::vector<std::uint64_t> starts,
+  std::size_t steps,
+  const std::string& logFile,
+  bool resume,
+  const std::vector<long long>& primes)
+{
+  std::map<std::uint64_t, AliquotSequence> sequences;
+  if (resume)
+  {
+    std::uintmax_t length = 0;
+    sequences = loadAliquotLog(logFile, length);
+    std::filesystem::resize_file(logFile, length); // drop a line cut short by a crash
+  }
+  for (const auto n : starts)
+  {
+    if (n == 0 || n > static_cast<std::uint64_t>(std::numeric_limits<long long>::max()))
+    {
+      throw std::out_of_range("aliquot sequences start between 1 and 2^63-1");
+    }
+    if (sequences[n].terms.empty())
+    {
+      sequences[n].terms.push_back(n);
+    }
+  }
+
+  std::ofstream log;
+  if (!logFile.empty())
+  {
+    log.open(logFile, resume ? std::ios::app : std::ios::trunc);
+    if (!resume)
+    {
+      log << "prime aliquot 1\n";
+    }
+    for (const auto& [start, sequence] : sequences)
+    {
+      if (sequence.terms.size() == 1)
+      {
+        log << start << " 0 " << start << '\n';
+      }
+    }
+    if (!log.flush())
+    {
+      throw std::runtime_error("cannot write '" + logFile + "'");
+    }
+  }
+
+  std::mutex lock; // guards the log and the cache
+  std::map<std::uint64_t, std::optional<std::uint64_t>> cache;
+  auto flushed = std::chrono::steady_clock::now();
+  const auto next = [&](std::uint64_t n) {
+    {
+      std::lock_guard guard(lock);
+      if (const auto it = cache.find(n); it != cache.end())
+      {
+        return it->second;
+      }
+    }
+    const auto sum = aliquotSum(n, primes);
+    std::lock_guard guard(lock);
+    if (cache.size() >= batchChunk)
+    {
+      cache.clear();
+    }
+    return cache[n] = sum;
+  };
+
+  std::vector<AliquotSequence*> work;
+  for (auto& [start, sequence] : sequences)
+  {
+    work.push_back(&sequence);
+  }
+  parallelFor(work.size(), [&](std::size_t i) {
+    const auto start = work[i]->terms.front();
+    work[i]->run(steps, next, [&](std::size_t index, std::uint64_t term) {
+      if (!logFile.empty())
+      {
+        std::lock_guard guard(lock);
+        log << start << ' ' << index << ' ' << term << '\n';
+        if (std::chrono::steady_clock::now() - flushed > checkpointInterval)
+        {
+          log.flush();
+          flushed = std::chrono::steady_clock::now();
+        }
+      }
+    });
+  });
+  if (!logFile.empty() && !log.flush())
+  {
+    throw std::runtime_error("cannot write '" + logFile + "'");
+  }
+
+  for (const auto& [start, sequence] : sequences)
+  {
+    fmt::print(
+      "{}: {} after {} steps, last term {}\n",
+      start,
+      sequence.end.empty() ? "open" : sequence.end,
+      sequence.terms.size() - 1,
+      sequence.terms.back());
+    if (trace)
+    {
+      for (std::size_t i = 0; i < sequence.terms.size(); ++i)
+      {
+        fmt::print("  {:5} {}\n", i, sequence.terms[i]);
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////
+// prime counting
+//////////////////////////////////////////////////////////////////
+
+/**
+ * Signed 128-bit two's complement integer, just what the pi(x) sums need: their terms fit in
+ * 64 bits but the totals pass 2^63 long before pi(x) does.
+ */
+struct Int128
+{
+  std::uint64_t lo = 0;
+  std::uint64_t hi = 0;
+
+  Int128& operator+=(const Int128& other) noexcept
+  {
+    lo += other.lo;
+    hi += other.hi + (lo < other.lo ? 1 : 0);
+    return *this;
+  }
+
+  Int128& operator+=(std::int64_t n) noexcept
+  {
+    return *this += Int128{.lo = static_cast<std::uint64_t>(n), .hi = (n < 0) ? ~std::uint64_t{0} : 0};
+  }
+
+  Int128 operator-() const noexcept
+  {
+    return {.lo = 0 - lo, .hi = ~hi + (lo == 0 ? 1 : 0)};
+  }
+
+  static Int128 product(std::int64_t a, std::int64_t b) noexcept
+  {
+    const auto magnitude = [](std::int64_t n) {
+      return (n < 0) ? 0 - static_cast<std::uint64_t>(n) : static_cast<std::uint64_t>(n);
+    };
+    Int128 result;
+    result.lo = wideMultiply(magnitude(a), magnitude(b), result.hi);
+    return ((a < 0) != (b < 0)) ? -result : result;
+  }
+};
+
+// phi(n, 6), the numbers <= n without the factors 2..13, repeats with period 2*3*5*7*11*13
+constexpr std::size_t phiPrimes = 6;
+constexpr std::uint64_t phiPeriod = 30030;
+constexpr std::uint64_t phiPerPeriod = 5760;
+
+std::uint64_t phiSmall(std::uint64_t n)
+{
+  static const auto table = [] {
+    std::vector<std::uint16_t> counts(phiPeriod);
+    std::uint16_t count = 0;
+    for (std::uint64_t i = 0; i < phiPeriod; ++i)
+    {
+      count += (std::gcd(i, phiPeriod) == 1) ? 1 : 0;
+      counts[i] = count;
+    }
+    return counts;
+  }();
+  return n / phiPeriod * phiPerPeriod + table[n % phiPeriod];
+}
+
+/**
+ * 64 bits of the numbers coprime to 2*3*5*7*11*13 from 'offset' on, to start a segment of the
+ * pi(x) sieve with the first six primes crossed off.
+ */
+std::uint64_t phiPattern(std::uint64_t offset)
+{
+  static const auto words = [] {
+    std::vector<std::uint64_t> bits((phiPeriod + 64) / 64 + 1);
+    for (std::uint64_t i = 0; i < phiPeriod + 64; ++i)
+    {
+      bits[i / 64] |= (std::gcd(i % phiPeriod, phiPeriod) == 1) ? std::uint64_t{1} << (i % 64) : 0;
+    }
+    return bits;
+  }();
+  const auto shift = offset % 64;
+  const auto word = words[offset / 64] >> shift;
+  return (shift == 0) ? word : word | words[offset / 64 + 1] << (64 - shift);
+}
+
+/**
+ * The tables pi(x) needs up to y: the primes with primes[1] = 2, pi(n) from a bit per number with
+ * the count before every 64 (a sixteenth of a plain table, so the random lookups of the easy
+ * leaves mostly hit the cache), and mu(n) times the least prime factor of n, 0 when n is not
+ * squarefree and y + 1 standing in for the factor of 1.
+ */
+struct PiTables
+{
+  std::vector<std::uint32_t> primes{0};
+  std::vector<std::array<std::uint64_t, 2>> piWords;
+  std::vector<std::int32_t> muFactor;
+
+  explicit PiTables(std::uint32_t y) : piWords(y / 64 + std::size_t{1}), muFactor(y + std::size_t{1})
+  {
+    sievePrimes(2, std::uint64_t{y} + 1, [&](std::uint64_t p) { primes.push_back(static_cast<std::uint32_t>(p)); });
+    std::vector<std::int8_t> mu(y + std::size_t{1}, 1);
+    for (std::size_t i = 1; i < primes.size(); ++i)
+    {
+      const std::uint64_t p = primes[i];
+      piWords[p / 64][0] |= std::uint64_t{1} << (p % 64);
+      for (auto j = p; j <= y; j += p)
+      {
+        mu[j] = static_cast<std::int8_t>(-mu[j]);
+        if (muFactor[j] == 0)
+        {
+          muFactor[j] = static_cast<std::int32_t>(p);
+        }
+      }
+      for (auto j = p * p; j <= y; j += p * p)
+      {
+        mu[j] = 0;
+      }
+    }
+    for (std::size_t i = 1; i < piWords.size(); ++i)
+    {
+      piWords[i][1] = piWords[i - 1][1] + static_cast<std::uint64_t>(std::popcount(piWords[i - 1][0]));
+    }
+    for (std::uint32_t n = 0; n <= y; ++n)
+    {
+      muFactor[n] *= mu[n];
+    }
+    muFactor[1] = static_cast<std::int32_t>(y + 1);
+  }
+
+  std::uint32_t pi(std::uint64_t n) const noexcept
+  {
+    const auto& [bits, before] = piWords[n / 64];
+    return static_cast<std::uint32_t>(before + static_cast<std::uint64_t>(std::popcount(bits & (~std::uint64_t{0} >> (63 - n % 64)))));
+  }
+};
+
+/**
+ * pi(x) = phi(x, a) + a - 1 - P2(x, a) with y >= x^(1/3) and a = pi(y), P2 counting the numbers
+ * <= x with two prime factors above y. phi(x, a) is the sum over the leaves of its recursion:
+ * the ordinary leaves mu(n) phi(x/n, 6) with n <= y and lpf(n) > 13, and the special leaves
+ * -mu(m) phi(x/(m p), b) with p the prime b + 1, m <= y < m p and lpf(m) > p. Special leaves are
+ * at most z = x/y; the hard ones need the sieve of [1, z] and the rest come from the pi table.
+ * Below bSquare p^2 <= y and m can be composite, from there on m is a prime above p and it gives
+ * a hard leaf up to last[b]. No leaf of b >= bHard needs the sieve.
+ */
+struct PiProblem
+{
+  std::uint64_t x;
+  std::uint32_t y;
+  std::uint64_t z;
+  PiTables tables;
+  std::size_t a;
+  std::size_t bSquare;
+  std::size_t bHard;
+  std::vector<std::uint32_t> last;
+  std::vector<std::pair<std::uint32_t, std::int32_t>> candidates; // m and mu(m) lpf(m) for the leaves below bSquare
+  std::uint64_t segment; // numbers in a segment of the sieve, a multiple of 256
+};
+
+/**
+ * Choose y = alpha x^(1/3) and set up the tables. A larger alpha moves work from the sieve of
+ * [1, x/y] to the tables and the easy leaves.
+ */
+PiProblem piProblem(std::uint64_t x)
+{
+  const auto root = integerRoot(x, 3);
+  const auto logX = std::log(static_cast<double>(x));
+  const auto alpha = std::max(1.0, logX * logX * logX / 1500);
+  const auto y = static_cast<std::uint32_t>(std::clamp<std::uint64_t>(
+    static_cast<std::uint64_t>(alpha * static_cast<double>(root)), root + 1, std::min<std::uint64_t>(integerRoot(x, 2), 1u << 30)));
+  checkMemory(static_cast<double>(y) * 6, "the pi(x) tables");
+
+  PiProblem problem{.x = x, .y = y, .z = x / y, .tables = PiTables(y), .a = 0, .bSquare = 0, .bHard = 0, .last = {}, .candidates = {}, .segment = 0};
+  const auto& primes = problem.tables.primes;
+  problem.a = problem.tables.pi(y);
+  problem.last.resize(problem.a);
+  problem.bSquare = problem.bHard = problem.a;
+  for (auto b = phiPrimes; b < problem.a; ++b)
+  {
+    const std::uint64_t p = primes[b + 1];
+    if (p * p <= y)
+    {
+      problem.last[b] = y;
+      continue;
+    }
+    const auto xp = x / p;
+    problem.last[b] = static_cast<std::uint32_t>(std::min<std::uint64_t>(y, std::max(xp / (std::uint64_t{y} + 1), xp / p / p)));
+    problem.bSquare = std::min(problem.bSquare, b);
+    if (problem.last[b] <= p)
+    {
+      problem.bHard = std::min(problem.bHard, b);
+    }
+  }
+
+  // most m have a factor <= 17 and are never part of a leaf
+  const std::int32_t smallest = primes[phiPrimes + 1];
+  for (std::uint32_t m = 2; m <= y; ++m)
+  {
+    if (const auto factor = problem.tables.muFactor[m]; factor > smallest || factor < -smallest)
+    {
+      problem.candidates.emplace_back(m, factor);
+    }
+  }
+
+  const auto width = std::bit_ceil(integerRoot(problem.z, 2));
+  problem.segment = std::clamp<std::uint64_t>(width, 1 << 12, sieveSegmentSize * 8);
+  return problem;
+}
+
+/**
+ * The ordinary leaves, the squarefree n <= y with lpf(n) > 13.
+ */
+Int128 ordinaryLeaves(const PiProblem& problem)
+{
+  const auto& muFactor = problem.tables.muFactor;
+  const std::int32_t largest = problem.tables.primes[phiPrimes];
+  Int128 sum;
+  for (std::uint32_t n = 1; n <= problem.y; ++n)
+  {
+    const auto factor = muFactor[n];
+    if (factor > largest)
+    {
+      sum += static_cast<std::int64_t>(phiSmall(problem.x / n));
+    }
+    else if (factor < -largest)
+    {
+      sum += -static_cast<std::int64_t>(phiSmall(problem.x / n));
+    }
+  }
+  return sum;
+}
+
+/**
+ * The special leaves that need no sieve, m prime with x/(m p) <= y and below p^2: phi is 1 when
+ * x/(m p) < p, otherwise 1 + pi(x/(m p)) - b. Consecutive m with the same pi(x/(m p)) are
+ * counted in one step from the pi table.
+ */
+Int128 easyLeaves(const PiProblem& problem)
+{
+  const auto& primes = problem.tables.primes;
+  const auto& tables = problem.tables;
+  const auto first = problem.bSquare;
+  std::vector<std::int64_t> sums(problem.a - first);
+  parallelFor(sums.size(), [&](std::size_t i) {
+    const auto b = first + i;
+    const std::uint64_t p = primes[b + 1];
+    const auto xp = problem.x / p;
+    const auto square = static_cast<std::uint32_t>(std::min<std::uint64_t>(problem.y, xp / p)); // n >= p up to here
+    auto sum = static_cast<std::int64_t>(tables.pi(problem.y)) - tables.pi(std::max<std::uint64_t>(p, square));
+    auto j = tables.pi(std::max<std::uint64_t>(p, problem.last[b])) + std::size_t{1};
+    for (const auto sparse = tables.pi(std::min<std::uint64_t>(square, integerRoot(xp, 2))); j <= sparse;)
+    {
+      // x/(m p) >= m here, the next few m often give the same pi
+      const auto l = tables.pi(xp / primes[j]);
+      const auto end = tables.pi(std::min<std::uint64_t>(square, xp / primes[l]));
+      sum += static_cast<std::int64_t>(end + 1 - j) * static_cast<std::int64_t>(1 + l - b);
+      j = end + std::size_t{1};
+    }
+    for (const auto end = tables.pi(square); j <= end; ++j)
+    {
+      sum += static_cast<std::int64_t>(1 + tables.pi(xp / primes[j]) - b);
+    }
+    sums[i] = sum;
+  });
+
+  Int128 total;
+  for (const auto sum : sums)
+  {
+    total += sum;
+  }
+  return total;
+}
+
+/**
+ * The hard leaves of the segments [first, last) of the sieve of [1, z] as if nothing came before
+ * 'first': the sum of -mu(m) phi, and for every b the leaf weight (the sum of -mu(m)) and the
+ * numbers left after crossing off the first b primes, so the caller can add what the earlier
+ * segments left. A counter per 256 numbers keeps the counts below each leaf cheap.
+ */
+struct HardChunk
+{
+  Int128 sum;
+  std::vector<std::int64_t> weights;
+  std::vector<std::uint64_t> counts;
+};
+
+HardChunk hardLeaves(const PiProblem& problem, std::uint64_t first, std::uint64_t last)
+{
+  const auto& primes = problem.tables.primes;
+  const auto& tables = problem.tables;
+  const auto x = problem.x;
+  const auto y = problem.y;
+  const auto span = problem.segment;
+  HardChunk chunk{.sum = {}, .weights = std::vector<std::int64_t>(problem.bHard), .counts = std::vector<std::uint64_t>(problem.bHard)};
+
+  std::vector<std::uint64_t> bits(span / 64);
+  std::vector<std::uint32_t> counters(span / 256);
+  std::vector<std::uint64_t> next(problem.bHard + 1); // next multiple of primes[b] to cross off
+  for (auto b = phiPrimes + 1; b <= problem.bHard; ++b)
+  {
+    const std::uint64_t p = primes[b];
+    next[b] = (1 + first * span + p - 1) / p * p;
+  }
+
+  for (auto s = first; s < last; ++s)
+  {
+    const auto low = 1 + s * span;
+    const auto high = std::min(low + span, problem.z + 1);
+    const auto size = high - low;
+    auto offset = low % phiPeriod;
+    for (std::size_t w = 0; w < bits.size(); ++w)
+    {
+      bits[w] = (w * 64 < size) ? phiPattern(offset) : 0;
+      offset = (offset + 64 < phiPeriod) ? offset + 64 : offset + 64 - phiPeriod;
+    }
+    if (size % 64 != 0)
+    {
+      bits[size / 64] &= ~std::uint64_t{0} >> (64 - size % 64);
+    }
+    std::uint64_t count = 0;
+    for (std::size_t i = 0; i < counters.size(); ++i)
+    {
+      counters[i] = 0;
+      for (auto w = i * 4; w < i * 4 + 4; ++w)
+      {
+        counters[i] += static_cast<std::uint32_t>(std::popcount(bits[w]));
+      }
+      count += counters[i];
+    }
+
+    const auto cross = [&](std::size_t b) {
+      const std::uint64_t p = primes[b];
+      auto j = next[b];
+      for (; j < high; j += p)
+      {
+        const auto k = j - low;
+        const auto removed = (bits[k / 64] >> (k % 64)) & 1;
+        bits[k / 64] &= ~(std::uint64_t{1} << (k % 64));
+        counters[k / 256] -= static_cast<std::uint32_t>(removed);
+        count -= removed;
+      }
+      next[b] = j;
+    };
+
+    for (auto b = phiPrimes; b < problem.bHard; ++b)
+    {
+      const std::uint64_t p = primes[b + 1];
+      const auto xp = x / p;
+      std::size_t block = 0;
+      std::uint64_t below = chunk.counts[b]; // left before this segment and before 'block'
+      const auto unsieved = [&](std::uint64_t n) {
+        const auto k = n - low;
+        for (; block < k / 256; ++block)
+        {
+          below += counters[block];
+        }
+        auto result = below;
+        for (auto w = block * 4; w < k / 64; ++w)
+        {
+          result += static_cast<std::uint64_t>(std::popcount(bits[w]));
+        }
+        return result + static_cast<std::uint64_t>(std::popcount(bits[k / 64] & (~std::uint64_t{0} >> (63 - k % 64))));
+      };
+
+      // m in (mLow, mHigh] puts x/(m p) in [low, high), the largest m first
+      std::int64_t sum = 0;
+      std::int64_t weight = 0;
+      const auto mHigh = std::min<std::uint64_t>(problem.last[b], xp / low);
+      if (b < problem.bSquare)
+      {
+        const auto mLow = std::max<std::uint64_t>(y / p, xp / high);
+        const auto& candidates = problem.candidates;
+        auto i = static_cast<std::size_t>(
+          std::upper_bound(candidates.begin(), candidates.end(), mHigh, [](auto m, const auto& c) { return m < c.first; })
+          - candidates.begin());
+        for (; i > 0 && candidates[i - 1].first > mLow; --i)
+        {
+          const auto [m, factor] = candidates[i - 1];
+          if (factor > static_cast<std::int64_t>(p))
+          {
+            sum -= static_cast<std::int64_t>(unsieved(xp / m));
+            --weight;
+          }
+          else if (factor < -static_cast<std::int64_t>(p))
+          {
+            sum += static_cast<std::int64_t>(unsieved(xp / m));
+            ++weight;
+          }
+        }
+      }
+      else
+      {
+        const auto mLow = std::max<std::uint64_t>(p, xp / high);
+        for (auto i = tables.pi(mHigh); mHigh > mLow && i > tables.pi(mLow); --i)
+        {
+          sum += static_cast<std::int64_t>(unsieved(xp / primes[i]));
+          ++weight;
+        }
+      }
+      chunk.sum += sum;
+      chunk.weights[b] += weight;
+      chunk.counts[b] += count;
+      cross(b + 1);
+    }
+  }
+  return chunk;
+}
+
+/**
+ * P2 of the numbers in [low, high): targets are x/q for the primes y < q <= sqrt(x), sorted
+ * downwards in 'large'. 'sum' adds the primes from low up to each target in the range.
+ */
+struct SecondChunk
+{
+  std::uint64_t primes = 0;
+  std::uint64_t targets = 0;
+  Int128 sum;
+};
+
+SecondChunk secondChunk(
+  std::uint64_t x,
+  const std::vector<std::uint32_t>& large,
+  const SieveBase& base,
+  std::uint64_t low,
+  std::uint64_t high)
+{
+  // x/q in [low, high) for q in (x/high, x/low]
+  auto j = std::lower_bound(large.begin(), large.end(), x / low, std::greater<>());
+  const auto end = std::lower_bound(j, large.end(), x / high, std::greater<>());
+  SecondChunk chunk;
+  std::uint64_t count = 0;
+  const auto resolve = [&](std::uint64_t below) {
+    for (; j != end && x / *j < below; ++j)
+    {
+      chunk.sum += static_cast<std::int64_t>(count);
+      ++chunk.targets;
+    }
+  };
+  sievePrimes(
+    low,
+    high,
+    base,
+    [&](std::uint64_t q) {
+      resolve(q);
+      ++count;
+    },
+    [](std::uint64_t) {});
+  resolve(high);
+  chunk.primes = count;
+  return chunk;
+}
+
+/**
+ * The state of a --pi run, saved like the sieve checkpoint: P2 and the hard leaves are summed
+ * in chunks, and for the hard leaves 'counts' holds what the sieve left before chunk hardNext.
+ */
+struct PiCheckpoint
+{
+  std::uint64_t x = 0;
+  std::uint64_t y = 0;
+  std::uint64_t segment = 0;
+  std::uint64_t secondSpan = 0;
+  std::uint64_t secondNext = 0;
+  std::uint64_t secondPrimes = 0;
+  Int128 second;
+  std::uint64_t hardNext = 0;
+  Int128 hard;
+  std::vector<std::uint64_t> counts;
+
+  void save(const std::string& fileName) const
+  {
+    const auto temporary = fileName + ".tmp";
+    {
+      std::ofstream out(temporary, std::ios::trunc);
+      out << "prime pi 1\n"
+          << x << ' ' << y << ' ' << segment << ' ' << secondSpan << ' ' << secondNext << ' ' << secondPrimes << ' '
+          << second.lo << ' ' << second.hi << ' ' << hardNext << ' ' << hard.lo << ' ' << hard.hi << ' ' << counts.size();
+      for (auto n : counts)
+      {
+        out << ' ' << n;
+      }
+      out << '\n';
+      if (!out.flush())
+      {
+        throw std::runtime_error("cannot write '" + temporary + "'");
+      }
+    }
+    std::filesystem::rename(temporary, fileName);
+  }
+
+  static PiCheckpoint load(const std::string& fileName)
+  {
+    std::ifstream in(fileName);
+    std::string header;
+    PiCheckpoint checkpoint;
+    std::size_t size = 0;
+    if (!std::getline(in, header) || header != "prime pi 1"
+        || !(in >> checkpoint.x >> checkpoint.y >> checkpoint.segment >> checkpoint.secondSpan >> checkpoint.secondNext
+             >> checkpoint.secondPrimes >> checkpoint.second.lo >> checkpoint.second.hi >> checkpoint.hardNext
+             >> checkpoint.hard.lo >> checkpoint.hard.hi >> size)
+        || size > (std::uint64_t{1} << 32))
+    {
+      throw std::runtime_error("cannot read checkpoint '" + fileName + "'");
+    }
+    checkpoint.counts.resize(size);
+    for (auto& n : checkpoint.counts)
+    {
+      in >> n;
+    }
+    if (!in)
+    {
+      throw std::runtime_error("cannot read checkpoint '" + fileName + "'");
+    }
+    return checkpoint;
+  }
+};
+
+/**
+ * --pi: the number of primes <= x by the combinatorial method of Deleglise and Rivat (see
+ * PiProblem), about x^(2/3) work instead of the x of a sieve. The hard leaves are summed over
+ * chunks of segments in parallel, P2 over chunks of [sqrt(x), x/y] with sievePrimes(); both are
+ * saved to the checkpoint file every checkpointInterval and 'resume' continues from it.
+ */
+std::uint64_t primeCount(std::uint64_t x, const std::string& checkpointFile, bool resume)
+{
+  if (x < (1 << 16))
+  {
+    std::uint64_t count = 0;
+    sievePrimes(2, x + 1, [&](std::uint64_t) { ++count; });
+    return count;
+  }
+
+  const auto started = std::chrono::steady_clock::now();
+  const auto problem = piProblem(x);
+  const auto root = integerRoot(x, 2);
+  std::vector<std::uint32_t> large; // the primes in (y, sqrt(x)], downwards
+  sievePrimes(std::uint64_t{problem.y} + 1, root + 1, [&](std::uint64_t q) { large.push_back(static_cast<std::uint32_t>(q)); });
+  std::reverse(large.begin(), large.end());
+
+  const auto top = x / (std::uint64_t{problem.y} + 1); // the largest x/q
+  const auto secondLength = large.empty() ? 0 : top + 1 - root;
+  const auto hardTotal = (problem.z + problem.segment - 1) / problem.segment;
+  const auto hardSpan = std::clamp<std::uint64_t>(hardTotal / 1024, 1, 64); // segments in a chunk
+  PiCheckpoint state{
+    .x = x,
+    .y = problem.y,
+    .segment = problem.segment,
+    .secondSpan = std::max<std::uint64_t>(secondLength / 1024, 1 << 24),
+    .secondNext = 0,
+    .secondPrimes = 0,
+    .second = {},
+    .hardNext = 0,
+    .hard = {},
+    .counts = std::vector<std::uint64_t>(problem.bHard)};
+  if (resume)
+  {
+    const auto saved = PiCheckpoint::load(checkpointFile);
+    if (saved.x != x || saved.y != state.y || saved.segment != state.segment || saved.secondSpan != state.secondSpan
+        || saved.counts.size() != state.counts.size())
+    {
+      throw std::runtime_error("checkpoint '" + checkpointFile + "' is for another --pi run");
+    }
+    state = saved;
+  }
+
+  const auto threads = std::max(1u, std::thread::hardware_concurrency());
+  auto saved = std::chrono::steady_clock::now();
+  const auto checkpoint = [&] {
+    const auto now = std::chrono::steady_clock::now();
+    if (!checkpointFile.empty() && now - saved >= checkpointInterval)
+    {
+      state.save(checkpointFile);
+      saved = now;
+    }
+  };
+
+  const auto secondTotal = (secondLength + state.secondSpan - 1) / state.secondSpan;
+  const auto secondBase = sieveBase(top + 1, state.secondSpan);
+  while (state.secondNext < secondTotal)
+  {
+    std::vector<SecondChunk> chunks(std::min<std::uint64_t>(secondTotal - state.secondNext, threads * 4));
+    parallelFor(chunks.size(), [&](std::size_t i) {
+      const auto low = root + (state.secondNext + i) * state.secondSpan;
+      chunks[i] = secondChunk(x, large, secondBase, low, std::min(low + state.secondSpan, top + 1));
+    });
+    for (const auto& chunk : chunks)
+    {
+      // x/q < root only when q = root
+      const auto before = problem.a + large.size() - (!large.empty() && large.front() == root) + state.secondPrimes;
+      state.second += chunk.sum;
+      state.second += Int128::product(static_cast<std::int64_t>(chunk.targets), static_cast<std::int64_t>(before));
+      state.secondPrimes += chunk.primes;
+    }
+    state.secondNext += chunks.size();
+    checkpoint();
+  }
+  const auto secondDone = std::chrono::steady_clock::now();
+
+  while (state.hardNext < hardTotal)
+  {
+    std::vector<HardChunk> chunks(std::min<std::uint64_t>((hardTotal - state.hardNext + hardSpan - 1) / hardSpan, threads * 4));
+    parallelFor(chunks.size(), [&](std::size_t i) {
+      const auto first = state.hardNext + i * hardSpan;
+      chunks[i] = hardLeaves(problem, first, std::min(first + hardSpan, hardTotal));
+    });
+    for (const auto& chunk : chunks)
+    {
+      state.hard += chunk.sum;
+      for (auto b = phiPrimes; b < problem.bHard; ++b)
+      {
+        state.hard += Int128::product(static_cast<std::int64_t>(state.counts[b]), chunk.weights[b]);
+        state.counts[b] += chunk.counts[b];
+      }
+    }
+    state.hardNext = std::min(state.hardNext + chunks.size() * hardSpan, hardTotal);
+    checkpoint();
+  }
+  if (!checkpointFile.empty())
+  {
+    state.save(checkpointFile);
+  }
+  const auto hardDone = std::chrono::steady_clock::now();
+
+  auto sum = ordinaryLeaves(problem);
+  const auto ordinaryDone = std::chrono::steady_clock::now();
+  sum += easyLeaves(problem);
+  sum += state.hard;
+  sum += static_cast<std::int64_t>(problem.a) - 1;
+  // P2 = sum of pi(x/q) - pi(q) + 1 over the large primes q
+  sum += -state.second;
+  for (std::size_t i = 0; i < large.size(); ++i)
+  {
+    sum += static_cast<std::int64_t>(problem.a + i);
+  }
+  if (trace)
+  {
+    const auto ms = [](auto from, auto to) { return std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count(); };
+    fmt::print(
+      "y = {}, z = {}, a = {}, hard leaves up to b = {}, {} segments of {}\n",
+      problem.y,
+      problem.z,
+      problem.a,
+      problem.bHard,
+      hardTotal,
+      problem.segment);
+    fmt::print(
+      "tables and P2 {} ms, hard leaves {} ms, ordinary leaves {} ms, easy leaves {} ms\n",
+      ms(started, secondDone),
+      ms(secondDone, hardDone),
+      ms(hardDone, ordinaryDone),
+      ms(ordinaryDone, std::chrono::steady_clock::now()));
+  }
+  if (sum.hi != 0)
+  {
+    throw std::runtime_error("pi(x) sum out of range");
+  }
+  return sum.lo;
+}
+
+//////////////////////////////////////////////////////////////////
+// prime sums
+//////////////////////////////////////////////////////////////////
+
+/**
+ * Arithmetic modulo 2^128 on Int128, exact as long as the result fits.
+ */
+struct WrapRing
+{
+  using Value = Int128;
+
+  Value fromInteger(std::uint64_t n) const noexcept
+  {
+    return {.lo = n, .hi = 0};
+  }
+
+  Value add(Value a, const Value& b) const noexcept
+  {
+    return a += b;
+  }
+
+  Value subtract(Value a, const Value& b) const noexcept
+  {
+    return a += -b;
+  }
+
+  Value multiply(const Value& a, const Value& b) const noexcept
+  {
+    Value result;
+    result.lo = wideMultiply(a.lo, b.lo, result.hi);
+    result.hi += a.lo * b.hi + a.hi * b.lo;
+    return result;
+  }
+};
+
+/**
+ * Arithmetic modulo any m >= 1: with m = 2^s q and q odd a number is kept as its residue mod 2^s
+ * and in Montgomery form mod q, toInteger() joins them with the Chinese remainder theorem.
+ */
+class ModRing
+{
+public:
+  struct Value
+  {
+    std::uint64_t power; // mod 2^s
+    std::uint64_t odd; // mod q, Montgomery form
+  };
+
+  explicit ModRing(std::uint64_t m) noexcept
+    : mask_((std::uint64_t{1} << std::countr_zero(m)) - 1)
+    , odd_(m >> std::countr_zero(m))
+  {
+    // q^-1 mod 2^64 by Newton iteration
+    inverse_ = odd_.modulus();
+    for (int i = 0; i < 5; ++i)
+    {
+      inverse_ *= 2 - odd_.modulus() * inverse_;
+    }
+  }
+
+  Value fromInteger(std::uint64_t n) const noexcept
+  {
+    return {.power = n & mask_, .odd = odd_.toMontgomery(n)};
+  }
+
+  Value add(const Value& a, const Value& b) const noexcept
+  {
+    return {.power = (a.power + b.power) & mask_, .odd = odd_.add(a.odd, b.odd)};
+  }
+
+  Value subtract(const Value& a, const Value& b) const noexcept
+  {
+    return {.power = (a.power - b.power) & mask_, .odd = odd_.subtract(a.odd, b.odd)};
+  }
+
+  Value multiply(const Value& a, const Value& b) const noexcept
+  {
+    return {.power = (a.power * b.power) & mask_, .odd = odd_.multiply(a.odd, b.odd)};
+  }
+
+  std::uint64_t toInteger(const Value& a) const noexcept
+  {
+    const auto odd = odd_.fromMontgomery(a.odd);
+    return odd + odd_.modulus() * (((a.power - odd) * inverse_) & mask_);
+  }
+
+private:
+  std::uint64_t mask_;
+  Montgomery<std::uint64_t> odd_;
+  std::uint64_t inverse_;
+};
+
+/**
+ * The sum of n^k over 2 <= n <= v. n^k is the sum of S(k, j) n(n-1)...(n-j+1) with S the
+ * Stirling numbers of the second kind in 'stirling', and those falling powers sum up to
+ * (v+1)v...(v+1-j)/(j+1) over 0 <= n <= v. Exactly one of the j+1 factors is a multiple of
+ * j+1 and it is divided before anything is reduced, so no inverse mod m is needed. v + 1 has to
+ * fit, so v < 2^64 - 1.
+ */
+template <typename Ring>
+typename Ring::Value powerSum(const Ring& ring, std::uint64_t v, const std::vector<typename Ring::Value>& stirling)
+{
+  auto sum = ring.fromInteger(0);
+  for (std::uint64_t j = 0; j < stirling.size() && j <= v; ++j)
+  {
+    auto term = stirling[j];
+    const auto multiple = (v + 1) % (j + 1);
+    for (std::uint64_t i = 0; i <= j; ++i)
+    {
+      const auto factor = v + 1 - i;
+      term = ring.multiply(term, ring.fromInteger((i == multiple) ? factor / (j + 1) : factor));
+    }
+    sum = ring.add(sum, term);
+  }
+  // n = 1, and n = 0 when 0^0 = 1
+  return ring.subtract(sum, ring.fromInteger(stirling.size() == 1 ? 2 : 1));
+}
+
+/**
+ * The sum of p^k over the primes p <= x in 'ring' by Lucy's dynamic programming in O(x^(3/4))
+ * steps on the 2 sqrt(x) values v = x/i: S(v) starts as the sum of n^k over 2 <= n <= v, and
+ * each prime p <= sqrt(x) takes p^k (S(v/p) - S(p-1)) from every v >= p^2, which leaves the
+ * primes. The values of a prime are updated from the largest down in waves of one block per
+ * thread; a wave only reads values below it, so its results are kept aside and written back
+ * after all of its blocks are done.
+ */
+template <typename Ring>
+typename Ring::Value primePowerSum(std::uint64_t x, unsigned k, const Ring& ring)
+{
+  using Value = typename Ring::Value;
+  if (x < 2)
+  {
+    return ring.fromInteger(0);
+  }
+
+  // values[i] is i + 1 up to root, then x/(size - i)
+  const auto root = integerRoot(x, 2);
+  const auto large = x / (root + 1);
+  const auto size = static_cast<std::size_t>(root + large);
+  const auto bytes = static_cast<double>(size) * (sizeof(Value) + 8);
+  checkMemory(bytes, "the prime sums");
+  std::vector<std::uint64_t> values;
+  std::vector<Value> sums;
+  try
+  {
+    values.resize(size);
+    sums.resize(size);
+  }
+  catch (const std::bad_alloc&)
+  {
+    throw std::runtime_error(fmt::format(
+      "the prime sums need about {} MB, more than can be allocated", static_cast<std::uint64_t>(bytes / (1 << 20))));
+  }
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    values[i] = (i < root) ? i + 1 : x / (size - i);
+  }
+  const auto index = [&](std::uint64_t v) { return (v <= root) ? static_cast<std::size_t>(v - 1) : size - x / v; };
+
+  std::vector<Value> stirling{ring.fromInteger(1)};
+  for (unsigned n = 1; n <= k; ++n)
+  {
+    std::vector<Value> next(n + 1, ring.fromInteger(0));
+    for (unsigned j = 1; j <= n; ++j)
+    {
+      next[j] = ring.add(ring.multiply(ring.fromInteger(j), (j < n) ? stirling[j] : ring.fromInteger(0)), stirling[j - 1]);
+    }
+    stirling = std::move(next);
+  }
+
+  constexpr std::size_t block = 1 << 14;
+  parallelFor((size + block - 1) / block, [&](std::size_t b) {
+    for (auto i = b * block; i < std::min(size, (b + 1) * block); ++i)
+    {
+      sums[i] = powerSum(ring, values[i], stirling);
+    }
+  });
+
+  const std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<Value> wave(std::min(size, block * threads));
+  sievePrimes(2, root + 1, [&](std::uint64_t p) {
+    const auto below = sums[p - 2]; // S(p - 1)
+    auto power = ring.fromInteger(1);
+    for (unsigned i = 0; i < k; ++i)
+    {
+      power = ring.multiply(power, ring.fromInteger(p));
+    }
+    const auto lowest = index(p * p);
+    for (auto top = size; top > lowest;)
+    {
+      const auto low = std::max(lowest, (top > wave.size()) ? top - wave.size() : 0);
+      parallelFor((top - low + block - 1) / block, [&](std::size_t b) {
+        for (auto i = low + b * block; i < std::min(top, low + (b + 1) * block); ++i)
+        {
+          // x/j/p is x/(j p), a large value as long as j p <= large
+          const auto j = size - i;
+          const auto from = (i >= root && j * p <= large) ? size - j * p : index(values[i] / p);
+          wave[i - low] = ring.subtract(sums[i], ring.multiply(power, ring.subtract(sums[from], below)));
+        }
+      });
+      std::copy(wave.begin(), wave.begin() + static_cast<std::ptrdiff_t>(top - low), sums.begin() + static_cast<std::ptrdiff_t>(low));
+      top = low;
+    }
+  });
+  return sums.back();
+}
+
+/**
+ * --primesum: the sum of p^k over the primes p <= x, exact or mod m when m != 0.
+ */
+void printPrimeSum(std::uint64_t x, unsigned k, std::uint64_t modulus)
+{
+  if (k > 64)
+  {
+    throw std::out_of_range("exponents go up to 64");
+  }
+  if (x == std::numeric_limits<std::uint64_t>::max())
+  {
+    throw std::out_of_range("x goes up to 18446744073709551614");
+  }
+  if (modulus != 0)
+  {
+    const ModRing ring(modulus);
+    std::cout << ring.toInteger(primePowerSum(x, k, ring)) << std::endl;
+    return;
+  }
+
+  // the sum of n^k up to x is below x^(k+1)/(k+1) + x^k
+  if ((k + 1) * std::log2(static_cast<double>(x) + 1) - std::log2(k + 1.0) > 127)
+  {
+    throw std::out_of_range("the sum needs more than 128 bits, please specify --mod {m}");
+  }
+  const auto sum = primePowerSum(x, k, WrapRing{});
+  std::cout << BigInt::fromLimbs({
+                                   static_cast<std::uint32_t>(sum.lo),
+                                   static_cast<std::uint32_t>(sum.lo >> 32),
+                                   static_cast<std::uint32_t>(sum.hi),
+                                   static_cast<std::uint32_t>(sum.hi >> 32),
+                                 })
+                 .toString()
+            << std::endl;
+}
+
+//////////////////////////////////////////////////////////////////
+
+/**
+ * Split [low, end) into 'shards' pieces of about equal sieving cost and return piece 'shard'
+ * (1-based) as [begin, end). Every piece but the first starts on a segment boundary of an
+ * unsharded run, so together the shards do exactly the work of one run. A number x is taken to
+ * cost 1 + ln ln x for the scan and crossing off, plus 8 / ln x for the expected prime when
+ * they are printed, which moves the boundaries of a long range noticeably towards its top.
+ */
+std::pair<std::uint64_t, std::uint64_t>
+  shardRange(std::uint64_t low, std::uint64_t end, unsigned shard, unsigned shards, bool print)
+{
+  const std::uint64_t span = 2 * sieveSegmentSize;
+  const auto first = std::max<std::uint64_t>(low, 3) | 1; // where sievePrimes() starts its segments
+  if (first >= end)
+  {
+    return (shard == 1) ? std::make_pair(low, end) : std::make_pair(end, end);
+  }
+
+  // the cost of the segments summed in at most 64K blocks
+  const auto segments = (end - first + span - 1) / span;
+  const auto step = segments / 65536 + 1;
+  const auto blocks = (segments + step - 1) / step;
+  std::vector<double> cumulative(blocks + 1, 0.0);
+  for (std::uint64_t b = 0; b < blocks; ++b)
+  {
+    const auto from = first + b * step * span;
+    const auto to = (end - from > step * span) ? from + step * span : end;
+    const auto x = std::max(16.0, (static_cast<double>(from) + static_cast<double>(to)) / 2);
+    const auto density = 1 + std::log(std::log(x)) + (print ? 8 / std::log(x) : 0);
+    cumulative[b + 1] = cumulative[b] + static_cast<double>(to - from) * density;
+  }
+
+  const auto boundary = [&](unsigned i) -> std::uint64_t {
+    if (i == 0)
+    {
+      return low;
+    }
+    if (i == shards)
+    {
+      return end;
+    }
+    const auto target = cumulative.back() * i / shards;
+    const auto b = static_cast<std::uint64_t>(
+      std::lower_bound(cumulative.begin(), cumulative.end(), target) - cumulative.begin());
+    return (b * step * span < end - first) ? first + b * step * span : end;
+  };
+  return std::make_pair(boundary(shard - 1), boundary(shard));
+}
+
+/**
+ * The result of a --count or --range run over the shard [begin, end) of [low, high]: the number
+ * of primes, the first and last of them and a histogram of the gaps between them. --output
+ * writes it as a binary file in native byte order, the header words, the primes themselves for
+ * --range and then the histogram, and --merge puts the shards back together.
+ */
+struct ShardResult
+{
+  static constexpr std::uint64_t magic = 0x3144524148535250; // "PRSHARD1"
+  static constexpr std::size_t headerWords = 12;
+
+  std::uint64_t mode = 0; // 1 count, 2 range
+  std::uint64_t low = 0;
+  std::uint64_t high = 0;
+  std::uint64_t shard = 1;
+  std::uint64_t shards = 1;
+  std::uint64_t begin = 0;
+  std::uint64_t end = 0;
+  std::uint64_t count = 0;
+  std::uint64_t first = 0; // 0 when there are no primes
+  std::uint64_t last = 0;
+  std::vector<std::uint64_t> gaps; // gaps[g] is the number of neighbouring primes g apart
+
+  void add(std::uint64_t p)
+  {
+    if (count++ == 0)
+    {
+      first = p;
+    }
+    else
+    {
+      const auto gap = p - last;
+      if (gap >= gaps.size())
+      {
+        gaps.resize(gap + 1);
+      }
+      ++gaps[gap];
+    }
+    last = p;
+  }
+
+  // same job and same shard of it
+  bool sameShard(const ShardResult& other) const noexcept
+  {
+    return mode == other.mode && low == other.low && high == other.high && shard == other.shard
+           && shards == other.shards && begin == other.begin && end == other.end;
+  }
+
+  std::array<std::uint64_t, headerWords> header() const noexcept
+  {
+    return {magic, mode, low, high, shard, shards, begin, end, count, first, last, gaps.size()};
+  }
+
+  static ShardResult fromHeader(const std::array<std::uint64_t, headerWords>& words, const std::string& fileName)
+  {
+    if (words[0] != magic || words[1] < 1 || words[1] > 2 || words[4] < 1 || words[4] > words[5]
+        || words[11] > (1u << 20))
+    {
+      throw std::runtime_error("'" + fileName + "' is not a shard result");
+    }
+    ShardResult result{
+      .mode = words[1],
+      .low = words[2],
+      .high = words[3],
+      .shard = words[4],
+      .shards = words[5],
+      .begin = words[6],
+      .end = words[7],
+      .count = words[8],
+      .first = words[9],
+      .last = words[10],
+      .gaps = std::vector<std::uint64_t>(words[11])};
+    return result;
+  }
+
+  void writeHeader(std::ostream& out) const
+  {
+    const auto words = header();
+    out.write(reinterpret_cast<const char*>(words.data()), sizeof(words));
+  }
+};
+
+/**
+ * How far a --count or --range job has come: every number below 'next' is done and 'result'
+ * holds what was found there. It is saved every checkpointInterval so that --resume can carry on
+ * after the process was killed.
+ */
+struct SieveCheckpoint
+{
+  std::uint64_t next = 0;
+  ShardResult result;
+
+  // written to a new file that is renamed over the old one, a crash leaves one or the other intact
+  void save(const std::string& fileName) const
+  {
+    const auto temporary = fileName + ".tmp";
+    {
+      std::ofstream out(temporary, std::ios::trunc);
+      out << "prime checkpoint 2\n" << next;
+      for (auto word : result.header())
+      {
+        out << ' ' << word;
+      }
+      for (auto n : result.gaps)
+      {
+        out << ' ' << n;
+      }
+      out << '\n';
+      if (!out.flush())
+      {
+        throw std::runtime_error("cannot write '" + temporary + "'");
+      }
+    }
+    std::filesystem::rename(temporary, fileName);
+  }
+
+  static SieveCheckpoint load(const std::string& fileName)
+  {
+    std::ifstream in(fileName);
+    std::string header;
+    SieveCheckpoint checkpoint;
+    std::array<std::uint64_t, ShardResult::headerWords> words{};
+    if (!std::getline(in, header) || header != "prime checkpoint 2" || !(in >> checkpoint.next))
+    {
+      throw std::runtime_error("cannot read checkpoint '" + fileName + "'");
+    }
+    for (auto& word : words)
+    {
+      in >> word;
+    }
+    checkpoint.result = ShardResult::fromHeader(words, fileName);
+    for (auto& n : checkpoint.result.gaps)
+    {
+      in >> n;
+    }
+    if (!in)
+    {
+      throw std::runtime_error("cannot read checkpoint '" + fileName + "'");
+    }
+    return checkpoint;
+  }
+};
+
+/**
+ * Count (or with 'print' list) the primes in shard i/n of [low, high] with the segmented sieve.
+ * With an output file the result goes there for --merge instead of to stdout. With a checkpoint
+ * file the position is saved between segments, with 'resume' the job continues from the saved
+ * position. A resumed --range to stdout prints again what came after the last checkpoint.
+ */
+void sieveRange(
+  bool print,
+  std::uint64_t low,
+  std::uint64_t high,
+  std::pair<unsigned, unsigned> shard,
+  const std::string& outputFile,
+  const std::string& checkpointFile,
+  bool resume)
+{
+  if (low > high || high == std::numeric_limits<std::uint64_t>::max())
+  {
+    throw std::out_of_range("invalid range");
+  }
+
+  const auto [begin, end] = shardRange(low, high + 1, shard.first, shard.second, print);
+  const auto root = std::sqrt(static_cast<double>(end));
+  checkMemory(static_cast<double>(sieveSegmentSize) + root / std::log(std::max(root, 16.0)) * 1.2 * 12, "the sieve");
+  SieveCheckpoint state{
+    .next = begin,
+    .result = {
+      .mode = print ? 2u : 1u,
+      .low = low,
+      .high = high,
+      .shard = shard.first,
+      .shards = shard.second,
+      .begin = begin,
+      .end = end,
+      .gaps = {}}};
+  if (resume)
+  {
+    const auto saved = SieveCheckpoint::load(checkpointFile);
+    if (!saved.result.sameShard(state.result))
+    {
+      throw std::invalid_argument(
+        "checkpoint '" + checkpointFile + "' is for --" + (saved.result.mode == 2 ? "range " : "count ")
+        + std::to_string(saved.result.low) + " " + std::to_string(saved.result.high) + " --shard "
+        + std::to_string(saved.result.shard) + "/" + std::to_string(saved.result.shards));
+    }
+    state = saved;
+    if (trace)
+    {
+      std::cout << "resuming at " << state.next << " with " << state.result.count << " primes" << std::endl;
+    }
+  }
+
+  std::fstream file;
+  if (!outputFile.empty())
+  {
+    if (resume)
+    {
+      // drop whatever was written after the checkpoint
+      std::filesystem::resize_file(
+        outputFile, (ShardResult::headerWords + (print ? state.result.count : 0)) * sizeof(std::uint64_t));
+      file.open(outputFile, std::ios::in | std::ios::out | std::ios::binary | std::ios::ate);
+    }
+    else
+    {
+      file.open(outputFile, std::ios::out | std::ios::trunc | std::ios::binary);
+      state.result.writeHeader(file);
+    }
+    if (!file)
+    {
+      throw std::runtime_error("cannot write '" + outputFile + "'");
+    }
+  }
+
+  fmt::memory_buffer out;
+  std::vector<std::uint64_t> pending; // primes not in the output file yet
+  const auto flush = [&]() {
+    std::fwrite(out.data(), 1, out.size(), stdout);
+    out.clear();
+    file.write(reinterpret_cast<const char*>(pending.data()), pending.size() * sizeof(std::uint64_t));
+    pending.clear();
+  };
+  auto saved = std::chrono::steady_clock::now();
+  const auto onPrime = [&](std::uint64_t p) {
+    if (!file.is_open())
+    {
+      ++state.result.count;
+      if (print)
+      {
+        fmt::format_to(std::back_inserter(out), "{}\n", p);
+        if (out.size() > 64 * 1024)
+        {
+          flush();
+        }
+      }
+      return;
+    }
+    state.result.add(p);
+    if (print)
+    {
+      pending.push_back(p);
+      if (pending.size() >= 8192)
+      {
+        flush();
+      }
+    }
+  };
+  const auto onSegment = [&](std::uint64_t next) {
+    state.next = next;
+    const auto now = std::chrono::steady_clock::now();
+    if (!checkpointFile.empty() && now - saved >= checkpointInterval)
+    {
+      // everything the checkpoint claims is done must have been written out
+      flush();
+      std::fflush(stdout);
+      file.flush();
+      state.save(checkpointFile);
+      saved = now;
+    }
+  };
+  if (state.next < end && sieveEngine == "atkin" && end <= atkinLimit)
+  {
+    atkinPrimes(state.next, end, onPrime, onSegment);
+  }
+  else if (state.next < end)
+  {
+    sievePrimes(state.next, end, onPrime, onSegment);
+  }
+  state.next = end;
+  flush();
+  std::fflush(stdout);
+
+  if (file.is_open())
+  {
+    file.write(reinterpret_cast<const char*>(state.result.gaps.data()), state.result.gaps.size() * sizeof(std::uint64_t));
+    file.seekp(0);
+    state.result.writeHeader(file);
+    if (!file.flush())
+    {
+      throw std::runtime_error("cannot write '" + outputFile + "'");
+    }
+  }
+  if (!checkpointFile.empty())
+  {
+    state.save(checkpointFile);
+  }
+
+  if (!print || file.is_open())
+  {
+    fmt::print("{} primes in [{}, {}]", state.result.count, begin, end - 1);
+    if (shard.second > 1)
+    {
+      fmt::print(" shard {}/{}", shard.first, shard.second);
+    }
+    fmt::print("\n");
+  }
+}
+
+/**
+ * Put the --output files of all shards of a --count or --range job back together. The shards
+ * must be of the same job and cover it exactly, each once, and every file must have the size its
+ * header says. The result is what the unsharded run would print, with -t the gap histogram too.
+ */
+void mergeShards(const std::vector<std::string>& fileNames)
+{
+  std::vector<std::pair<ShardResult, std::string>> shards;
+  for (const auto& fileName : fileNames)
+  {
+    std::ifstream in(fileName, std::ios::binary);
+    std::array<std::uint64_t, ShardResult::headerWords> words{};
+    if (!in.read(reinterpret_cast<char*>(words.data()), sizeof(words)))
+    {
+      throw std::runtime_error("cannot read '" + fileName + "'");
+    }
+    auto result = ShardResult::fromHeader(words, fileName);
+    const auto primes = (result.mode == 2) ? result.count : 0;
+    in.seekg(static_cast<std::streamoff>(primes * sizeof(std::uint64_t)), std::ios::cur);
+    in.read(reinterpret_cast<char*>(result.gaps.data()), result.gaps.size() * sizeof(std::uint64_t));
+    const auto size = (ShardResult::headerWords + primes + result.gaps.size()) * sizeof(std::uint64_t);
+    if (!in || std::filesystem::file_size(fileName) != size
+        || std::accumulate(result.gaps.begin(), result.gaps.end(), std::uint64_t{0}) + (result.count > 0)
+             != result.count)
+    {
+      throw std::runtime_error("'" + fileName + "' is truncated or damaged");
+    }
+    shards.emplace_back(std::move(result), fileName);
+  }
+  if (shards.empty())
+  {
+    throw std::invalid_argument("--merge needs the shard files");
+  }
+
+  std::sort(shards.begin(), shards.end(), [](const auto& a, const auto& b) { return a.first.shard < b.first.shard; });
+  const auto& job = shards.front().first;
+  for (std::size_t i = 0; i < shards.size(); ++i)
+  {
+    const auto& [result, fileName] = shards[i];
+    if (result.mode != job.mode || result.low != job.low || result.high != job.high || result.shards != job.shards)
+    {
+      throw std::runtime_error("'" + fileName + "' is from another job than '" + shards.front().second + "'");
+    }
+    if (i > 0 && result.shard == shards[i - 1].first.shard)
+    {
+      throw std::runtime_error(
+        fmt::format("shard {} is given twice, in '{}' and '{}'", result.shard, shards[i - 1].second, fileName));
+    }
+  }
+  // sorted without duplicates, so shard i + 1 is at i unless one is missing
+  for (std::uint64_t shard = 1; shard <= job.shards; ++shard)
+  {
+    if (shard > shards.size() || shards[shard - 1].first.shard != shard)
+    {
+      throw std::runtime_error(fmt::format("shard {} of {} is missing", shard, job.shards));
+    }
+  }
+  for (std::size_t i = 0; i < shards.size(); ++i)
+  {
+    const auto& [result, fileName] = shards[i];
+    if (result.begin != (i == 0 ? job.low : shards[i - 1].first.end)
+        || (i + 1 == shards.size() && result.end != job.high + 1))
+    {
+      throw std::runtime_error("'" + fileName + "' does not fit the shards next to it");
+    }
+  }
+
+  // the histogram of each shard plus the gaps across the boundaries
+  ShardResult total{.mode = job.mode, .low = job.low, .high = job.high, .gaps = {}};
+  fmt::memory_buffer out;
+  for (const auto& [result, fileName] : shards)
+  {
+    if (result.count == 0)
+    {
+      continue;
+    }
+    if (total.count > 0)
+    {
+      total.add(result.first);
+      --total.count;
+    }
+    total.count += result.count;
+    total.last = result.last;
+    if (result.gaps.size() > total.gaps.size())
+    {
+      total.gaps.resize(result.gaps.size());
+    }
+    std::transform(result.gaps.begin(), result.gaps.end(), total.gaps.begin(), total.gaps.begin(), std::plus<>());
+
+    if (job.mode == 2)
+    {
+      std::ifstream in(fileName, std::ios::binary);
+      in.seekg(ShardResult::headerWords * sizeof(std::uint64_t));
+      std::vector<std::uint64_t> chunk(8192);
+      for (auto left = result.count; left > 0;)
+      {
+        const auto n = std::min<std::uint64_t>(left, chunk.size());
+        in.read(reinterpret_cast<char*>(chunk.data()), static_cast<std::streamsize>(n * sizeof(std::uint64_t)));
+        for (std::size_t i = 0; i < n; ++i)
+        {
+          fmt::format_to(std::back_inserter(out), "{}\n", chunk[i]);
+        }
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        out.clear();
+        left -= n;
+      }
+    }
+  }
+  std::fflush(stdout);
+
+  if (job.mode == 1)
+  {
+    fmt::print("{} primes in [{}, {}]\n", total.count, job.low, job.high);
+  }
+  if (trace)
+  {
+    for (std::size_t gap = 0; gap < total.gaps.size(); ++gap)
+    {
+      if (total.gaps[gap] != 0)
+      {
+        std::cout << "gap " << gap << ": " << total.gaps[gap] << std::endl;
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////
+// compressed prime export
+//////////////////////////////////////////////////////////////////
+
+/**
+ * --export writes the primes of [low, high] in blocks of exportSpan numbers, each block the Rice
+ * code of the gaps between its primes. Above 3 the gaps are even and roughly geometric with mean
+ * ln p, so gap/2 - 1 coded with 2^k close to ln 2 (ln p / 2 - 1) costs a few percent over their
+ * entropy, about 5.5 bits a prime near 10^13 instead of 64. A block is the byte k and then the
+ * code, the gap from 2 to 3 is coded as 0. The index follows the blocks, the first prime, the
+ * count and the file offset of every block, and the header in front says where it starts. All
+ * words are in native byte order like the shard results.
+ */
+struct ExportHeader
+{
+  static constexpr std::uint64_t magic = 0x3154525058455250; // "PREXPRT1"
+  static constexpr std::size_t words = 7;
+
+  std::uint64_t low = 0;
+  std::uint64_t high = 0;
+  std::uint64_t span = 0;
+  std::uint64_t blocks = 0;
+  std::uint64_t count = 0;
+  std::uint64_t index = 0; // offset of the index
+
+  void write(std::ostream& out) const
+  {
+    const std::array<std::uint64_t, words> header{magic, low, high, span, blocks, count, index};
+    out.write(reinterpret_cast<const char*>(header.data()), sizeof(header));
+  }
+
+  static ExportHeader read(std::istream& in, const std::string& fileName)
+  {
+    std::array<std::uint64_t, words> header{};
+    if (!in.read(reinterpret_cast<char*>(header.data()), sizeof(header)) || header[0] != magic || header[3] == 0)
+    {
+      throw std::runtime_error("'" + fileName + "' is not a prime export");
+    }
+    return {.low = header[1], .high = header[2], .span = header[3], .blocks = header[4], .count = header[5], .index = header[6]};
+  }
+};
+
+constexpr std::uint64_t exportSpan = std::uint64_t{1} << 26;
+
+/**
+ * Bits packed into bytes least significant first.
+ */
+class BitWriter
+{
+public:
+  explicit BitWriter(std::vector<std::uint8_t>& out) noexcept
+    : out_(out)
+  {
+  }
+
+  // count <= 56
+  void write(std::uint64_t value, unsigned count)
+  {
+    buffer_ |= value << bits_;
+    bits_ += count;
+    for (; bits_ >= 8; bits_ -= 8)
+    {
+      out_.push_back(static_cast<std::uint8_t>(buffer_));
+      buffer_ >>= 8;
+    }
+  }
+
+  // n ones and a zero
+  void writeUnary(std::uint64_t n)
+  {
+    for (; n >= 32; n -= 32)
+    {
+      write(0xffffffff, 32);
+    }
+    write((std::uint64_t{1} << n) - 1, static_cast<unsigned>(n) + 1);
+  }
+
+  void flush()
+  {
+    if (bits_ != 0)
+    {
+      out_.push_back(static_cast<std::uint8_t>(buffer_));
+    }
+    buffer_ = 0;
+    bits_ = 0;
+  }
+
+private:
+  std::vector<std::uint8_t>& out_;
+  std::uint64_t buffer_ = 0;
+  unsigned bits_ = 0;
+};
+
+class BitReader
+{
+public:
+  explicit BitReader(std::span<const std::uint8_t> data) noexcept
+    : data_(data)
+  {
+  }
+
+  // count <= 56
+  std::uint64_t read(unsigned count)
+  {
+    refill(count);
+    const auto value = buffer_ & ((std::uint64_t{1} << count) - 1);
+    buffer_ >>= count;
+    bits_ -= count;
+    return value;
+  }
+
+  std::uint64_t readUnary()
+  {
+    std::uint64_t n = 0;
+    for (;;)
+    {
+      refill(1);
+      const auto ones = static_cast<unsigned>(std::countr_one(buffer_));
+      if (ones < bits_)
+      {
+        buffer_ >>= ones + 1;
+        bits_ -= ones + 1;
+        return n + ones;
+      }
+      n += bits_;
+      buffer_ = 0;
+      bits_ = 0;
+    }
+  }
+
+private:
+  // up to 63 bits, so that readUnary() never shifts by 64
+  void refill(unsigned count)
+  {
+    for (; bits_ < 56 && next_ < data_.size(); bits_ += 8)
+    {
+      buffer_ |= std::uint64_t{data_[next_++]} << bits_;
+    }
+    if (bits_ < count)
+    {
+      throw std::runtime_error("prime export block is damaged");
+    }
+  }
+
+  std::span<const std::uint8_t> data_;
+  std::size_t next_ = 0;
+  std::uint64_t buffer_ = 0;
+  unsigned bits_ = 0;
+};
+
+struct ExportBlock
+{
+  std::uint64_t first = 0; // 0 when there are no primes
+  std::uint64_t count = 0;
+  std::vector<std::uint8_t> code;
+};
+
+/**
+ * Sieve [low, high) and code the gaps on the fly, k comes from the expected gap in the middle.
+ */
+ExportBlock compressBlock(std::uint64_t low, std::uint64_t high, const SieveBase& base)
+{
+  const auto mean = std::log(static_cast<double>(std::max<std::uint64_t>(low + (high - low) / 2, 3))) / 2 - 1;
+  const auto k = (mean * std::log(2.0) > 1) ? static_cast<unsigned>(std::lround(std::log2(mean * std::log(2.0)))) : 0u;
+  ExportBlock block;
+  block.code.push_back(static_cast<std::uint8_t>(k));
+  BitWriter writer(block.code);
+  std::uint64_t previous = 0;
+  sievePrimes(low, high, base, [&](std::uint64_t p) {
+    if (block.count++ == 0)
+    {
+      block.first = p;
+    }
+    else
     {
-      std::cout << *it << " ";
+      const auto u = (previous == 2) ? 0 : (p - previous) / 2 - 1;
+      writer.writeUnary(u >> k);
+      writer.write(u & ((std::uint64_t{1} << k) - 1), k);
     }
-    std::cout << std::endl;
-  }
-
-  return primes;
+    previous = p;
+  }, [](std::uint64_t) {});
+  writer.flush();
+  return block;
 }
 
 /**
- * Given a number, calculate the prime numbers in it.
+ * The primes of one block back from its code.
  */
-std::vector<long long> divideWithPrimes(long long number, const std::vector<long long>& primes)
+template <typename OnPrime>
+void decompressBlock(std::uint64_t first, std::uint64_t count, std::span<const std::uint8_t> code, const OnPrime& onPrime)
 {
-  std::vector<long long> factors;
-
-  if (number == 1)
+  if (count == 0)
   {
-    factors.push_back(1);
-    return factors;
+    return;
   }
-
-  for (auto n : primes)
+  if (code.empty() || code[0] > 56)
   {
-    while (number % n == 0 && number != 1)
-    {
-      factors.push_back(n);
-      number /= n;
-    }
+    throw std::runtime_error("prime export block is damaged");
+  }
+  const unsigned k = code[0];
+  BitReader reader(code.subspan(1));
+  auto p = first;
+  onPrime(p);
+  for (std::uint64_t i = 1; i < count; ++i)
+  {
+    const auto u = (reader.readUnary() << k) | reader.read(k);
+    p = (p == 2) ? 3 : p + 2 * (u + 1);
+    onPrime(p);
   }
-
-  return factors;
 }
 
 /**
- * Take a sorted vector of prime numbers and prints them to stdout.
+ * --export: write the primes of [low, high] to 'fileName'. One block per thread is sieved and
+ * compressed at a time and the blocks are written in order, the index goes to a side file until
+ * the end, so the memory does not depend on the range. Everything is written to a temporary
+ * file that only replaces 'fileName' once it is complete.
  */
-
-void printFactors(std::vector<long long>& factors)
+void exportPrimes(std::uint64_t low, std::uint64_t high, const std::string& fileName)
 {
-  int count = 0;
-  std::cout << std::setw(3);
-  for (auto i : factors)
+  if (low > high || high == std::numeric_limits<std::uint64_t>::max())
   {
-    std::cout << ((count++ == 0) ? " " : "*") << i;
+    throw std::out_of_range("invalid range");
+  }
+  if (fileName.empty())
+  {
+    throw std::invalid_argument("--export needs --output {file}");
   }
-  std::cout << std::endl;
-}
 
-/**
- * Convert a decimal value to int e.g. 0.25 --> 1/4
- */
+  const std::size_t threads = (threadLimit != 0) ? threadLimit : std::max(1u, std::thread::hardware_concurrency());
+  // the sieving primes are shared, their next multiples are per block
+  const auto base = sieveBase(high + 1, exportSpan);
+  const auto baseBytes = static_cast<double>(base.primes.size()) * sizeof(std::uint32_t);
+  checkMemory(
+    baseBytes + static_cast<double>(threads) * (static_cast<double>(sieveSegmentSize) + baseBytes * 2 + exportSpan / 8.0),
+    "the export");
 
-bool extractNumeratorDenominator(std::string line, long long& numerator, long long& denominator)
-{
-  bool ok = true;
+  ExportHeader header{.low = low, .high = high, .span = exportSpan, .blocks = (high - low) / exportSpan + 1, .count = 0, .index = 0};
+  const auto temporary = fileName + ".tmp";
+  const auto indexFile = fileName + ".index";
+  std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+  std::fstream index(indexFile, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+  const auto removeTemporaries = [&] {
+    out.close();
+    index.close();
+    std::error_code ignored;
+    std::filesystem::remove(temporary, ignored);
+    std::filesystem::remove(indexFile, ignored);
+  };
+  if (!out || !index)
+  {
+    removeTemporaries();
+    throw std::runtime_error("cannot write '" + temporary + "'");
+  }
+  header.write(out);
+  std::uint64_t offset = ExportHeader::words * sizeof(std::uint64_t);
   try
   {
-    const auto pos = line.find('.');
-
-    if (pos != 0 && line.length() - pos >= 9)
+    for (std::uint64_t next = 0; next < header.blocks;)
     {
-      throw std::out_of_range("line too long");
+      std::vector<ExportBlock> done(std::min<std::uint64_t>(threads, header.blocks - next));
+      parallelFor(done.size(), [&](std::size_t i) {
+        const auto begin = low + (next + i) * exportSpan;
+        done[i] = compressBlock(begin, (high - begin < exportSpan) ? high + 1 : begin + exportSpan, base);
+      });
+      for (const auto& block : done)
+      {
+        const std::array<std::uint64_t, 3> entry{block.first, block.count, offset};
+        index.write(reinterpret_cast<const char*>(entry.data()), sizeof(entry));
+        out.write(reinterpret_cast<const char*>(block.code.data()), static_cast<std::streamsize>(block.code.size()));
+        offset += block.code.size();
+        header.count += block.count;
+      }
+      next += done.size();
     }
+  }
+  catch (...)
+  {
+    removeTemporaries();
+    throw;
+  }
 
-    int m = (pos != 0) ? std::stoi(line.substr(0, pos)) : 0; // 2.25 -> m = 2   .25 -> m = 0
-    line = line.substr(pos);
-
-    const auto len = line.length(); // .12 = 3
+  header.index = offset;
+  index.seekg(0);
+  out << index.rdbuf();
+  out.seekp(0);
+  header.write(out);
+  if (!out.flush() || !index)
+  {
+    removeTemporaries();
+    throw std::runtime_error("cannot write '" + temporary + "'");
+  }
+  out.close();
+  index.close();
+  std::filesystem::remove(indexFile);
+  std::filesystem::rename(temporary, fileName);
 
-    denominator = 1; // namnare
-    for (size_t i = 1; i < len; ++i)
-    {
-      denominator *= 10; // .12 --> 12/100
-    }
+  fmt::print("{} primes in [{}, {}]\n", header.count, low, high);
+  if (trace)
+  {
+    fmt::print(
+      "{} blocks, {} bytes, {:.2f} bits a prime\n",
+      header.blocks,
+      std::filesystem::file_size(fileName),
+      (header.count == 0) ? 0.0 : static_cast<double>(header.index) * 8 / static_cast<double>(header.count));
+  }
+}
 
-    numerator = stoi(line.substr(1, len - 1)); // taljare.
-    numerator += denominator * m;
+/**
+ * --extract: print the primes of [low, high] from an --export file, reading only the blocks
+ * the index says are in range.
+ */
+void extractPrimes(const std::string& fileName, std::uint64_t low, std::uint64_t high)
+{
+  std::ifstream in(fileName, std::ios::binary);
+  const auto header = ExportHeader::read(in, fileName);
+  if (header.blocks != (header.high - header.low) / header.span + 1
+      || std::filesystem::file_size(fileName) != header.index + header.blocks * 3 * sizeof(std::uint64_t))
+  {
+    throw std::runtime_error("'" + fileName + "' is truncated or damaged");
   }
-  catch (const std::out_of_range& ex)
+  low = std::max(low, header.low);
+  high = std::min(high, header.high);
+
+  fmt::memory_buffer out;
+  std::vector<std::uint8_t> code;
+  for (auto b = (low - header.low) / header.span; low <= high && b <= (high - header.low) / header.span; ++b)
   {
-    if (ex.what() != nullptr)
+    // this entry and the next one, whose offset ends the block
+    std::array<std::uint64_t, 6> entry{0, 0, 0, 0, 0, header.index};
+    const auto last = (b + 1 == header.blocks);
+    in.seekg(static_cast<std::streamoff>(header.index + b * 3 * sizeof(std::uint64_t)));
+    in.read(reinterpret_cast<char*>(entry.data()), static_cast<std::streamsize>((last ? 3 : 6) * sizeof(std::uint64_t)));
+    if (!in || entry[2] > entry[5] || entry[5] > header.index)
     {
-      std::cout << "number has too many digits " << ex.what() << std::endl;
+      throw std::runtime_error("'" + fileName + "' is truncated or damaged");
     }
-    ok = false;
+    code.resize(entry[5] - entry[2]);
+    in.seekg(static_cast<std::streamoff>(entry[2]));
+    in.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(code.size()));
+    decompressBlock(entry[0], entry[1], code, [&](std::uint64_t p) {
+      if (p >= low && p <= high)
+      {
+        fmt::format_to(std::back_inserter(out), "{}\n", p);
+      }
+    });
+    std::fwrite(out.data(), 1, out.size(), stdout);
+    out.clear();
   }
-  return ok;
+  std::fflush(stdout);
 }
 
+//////////////////////////////////////////////////////////////////
+
 /**
- * Given factors, calculate product
+ * Legendre's formula, the exponent of every prime p <= n in n! is n/p + n/p^2 + n/p^3 + ...
+ * which needs the primes up to n but never n! itself.
  */
-inline long long calculateProduct(std::vector<long long>& factors) noexcept
+template <typename OnFactor>
+void factorialExponents(std::uint64_t n, const std::vector<long long>& primes, const OnFactor& onFactor)
 {
-  long long n = 1;
-  for (auto i : factors)
+  if (n < 2)
   {
-    n *= i;
+    return;
   }
-  return n;
+  forEachPrime(n, primes, [&](std::uint64_t p) {
+    std::uint64_t exponent = 0;
+    for (auto q = n / p; q > 0; q /= p)
+    {
+      exponent += q;
+    }
+    onFactor(p, exponent);
+  });
 }
 
 /**
- * given two vectors, remove common elements in the vectors.
- *
- * e.g.
- * {1,2,3,3}
- * {2,3,4,5}
- * --> {1,3} {4,5}
+ * Kummer's theorem, the exponent of p in C(n,k) is the number of carries when k and n-k are
+ * added in base p. Primes with no carry do not divide C(n,k) and are skipped.
  */
-std::pair<std::vector<long long>, std::vector<long long>>
-  removeCommonNumbers(const std::vector<long long>& numerator, const std::vector<long long>& denominator)
+template <typename OnFactor>
+void binomialExponents(std::uint64_t n, std::uint64_t k, const std::vector<long long>& primes, const OnFactor& onFactor)
 {
-  std::vector<long long> inter;
-
-  // determine common numbers, put common numbers in 'inter'
-  std::set_intersection(numerator.begin(), numerator.end(), denominator.begin(), denominator.end(), std::back_inserter(inter));
-
-  if (trace)
+  k = std::min(k, n - k);
+  if (k == 0)
   {
-    std::cout << "remove common numbers, use an intersection for this (c++ algorithm)" << std::endl
-              << std::endl;
-
-    std::cout << "  intersection:";
-    for (auto i : inter)
+    return;
+  }
+  forEachPrime(n, primes, [&](std::uint64_t p) {
+    std::uint64_t exponent = 0;
+    std::uint64_t carry = 0;
+    for (auto a = k, b = n - k; a > 0 || b > 0 || carry > 0; a /= p, b /= p)
     {
-      std::cout << i << " ";
+      carry = (a % p + b % p + carry >= p) ? 1 : 0;
+      exponent += carry;
     }
-    std::cout << std::endl;
-  }
-
-  // are there any common numbers? if not we return vectors as is.
-  if (!inter.empty())
-  {
-    // remove elements from numerator vector
-    std::vector<long long> leftn;
-    std::set_difference(
-      numerator.begin(), numerator.end(), inter.begin(), inter.end(), std::inserter(leftn, leftn.begin()));
-
-    if (leftn.empty())
+    if (exponent > 0)
     {
-      leftn.push_back(1);
+      onFactor(p, exponent);
     }
+  });
+}
 
-    if (trace)
+/**
+ * Print "label = 2^a*3^b*..." for the factors produced by 'produce'. With n = 10^9 there are
+ * some fifty million factors, so they are formatted into a buffer that is written out in large
+ * chunks rather than printed one at a time.
+ */
+template <typename Produce>
+void printExponents(const std::string& label, const Produce& produce)
+{
+  fmt::memory_buffer out;
+  fmt::format_to(std::back_inserter(out), "\n{} = ", label);
+  auto count = 0ull; // number of factors printed
+  produce([&](std::uint64_t p, std::uint64_t exponent) {
+    if (count++ > 0)
     {
-      std::cout << "  -------------" << std::endl;
-      std::cout << "  new numerator:";
-      for (auto i : leftn)
-      {
-        std::cout << i << " ";
-      }
-      std::cout << std::endl;
+      out.push_back('*');
     }
-
-    // remove elements from denominator vector
-    std::vector<long long> leftd;
-    std::set_difference(
-      denominator.begin(), denominator.end(), inter.begin(), inter.end(), std::inserter(leftd, leftd.begin()));
-
-    if (leftd.empty())
+    if (exponent != 1)
     {
-      leftd.push_back(1);
+      fmt::format_to(std::back_inserter(out), "{}^{}", p, exponent);
     }
-
-    if (trace)
+    else
     {
-      std::cout << "  new denominator:";
-      for (auto i : leftd)
-      {
-        std::cout << i << " ";
-      }
-      std::cout << std::endl << std::endl;
+      fmt::format_to(std::back_inserter(out), "{}", p);
     }
-
-    // return new vectors.
-    return std::make_pair(leftn, leftd);
-  }
-  else
+    if (out.size() > 64 * 1024)
+    {
+      std::fwrite(out.data(), 1, out.size(), stdout);
+      out.clear();
+    }
+  });
+  if (count == 0)
   {
-    return std::make_pair(numerator, denominator);
+    out.push_back('1');
   }
+  out.push_back('\n');
+  std::fwrite(out.data(), 1, out.size(), stdout);
+  std::fflush(stdout);
 }
 
-//////////////////////////////////////////////////////////////////
-// main functions
-//////////////////////////////////////////////////////////////////
-
-std::pair<long long, long long> decimalToFraction(const std::string& number, const std::vector<long long>& primes, const bool output)
+void factorizeFactorial(long long n, const std::vector<long long>& primes)
 {
-  long long numerator = 1;
-  long long denominator = 1;
-
-  // given .12 create an integer version of it, i.e. 12/100
-  if (!extractNumeratorDenominator(number, numerator, denominator))
+  if (n < 0)
   {
-    return std::make_pair(0, 0);
+    throw std::invalid_argument("n! needs n >= 0");
   }
+  printExponents(fmt::format("{}!", n), [&](const auto& onFactor) {
+    factorialExponents(static_cast<std::uint64_t>(n), primes, onFactor);
+  });
+}
 
-  if (trace)
+void factorizeBinomial(long long n, long long k, const std::vector<long long>& primes)
+{
+  if (n < 0 || k < 0 || k > n)
   {
-    std::cout << "remove decimal point by multiplication" << std::endl;
-    std::cout << "  " << numerator << "/" << denominator << std::endl << std::endl;
+    throw std::invalid_argument("C(n,k) needs 0 <= k <= n");
   }
+  printExponents(fmt::format("C({},{})", n, k), [&](const auto& onFactor) {
+    binomialExponents(static_cast<std::uint64_t>(n), static_cast<std::uint64_t>(k), primes, onFactor);
+  });
+}
 
-  // divide numerator and denominator into primes
-  auto factorsNumerator = divideWithPrimes(numerator, primes);
-  auto factorsDenominator = divideWithPrimes(denominator, primes);
+//////////////////////////////////////////////////////////////////
 
-  if (trace)
-  {
-    std::cout << "calculate prime numbers for numerator and denominator" << std::endl;
-    printFactors(factorsNumerator);
-    std::cout << "--------------------------" << std::endl;
-    printFactors(factorsDenominator);
-    std::cout << std::endl;
-  }
+/**
+ * Micro benchmarks, each line is the average time per call over a million random inputs.
+ */
+void runBenchmarks(const std::vector<long long>& primes)
+{
+  using namespace std::chrono;
 
-  // given the vectors of primes, remove common ones from numerator and
-  // denominator
-  auto [num, den] = removeCommonNumbers(factorsNumerator, factorsDenominator);
+  const auto measure = [](const char* name, const auto& values, const auto& test) {
+    std::size_t found = 0;
+    const auto start = steady_clock::now();
+    for (const auto& x : values)
+    {
+      found += test(x) ? 1 : 0;
+    }
+    const auto stop = steady_clock::now();
+    const auto ns = static_cast<double>(duration_cast<nanoseconds>(stop - start).count()) / values.size();
+    fmt::print("{:<45} {:8.1f} ns/call  ({} primes)\n", name, ns, found);
+  };
 
-  if (trace)
+  std::mt19937_64 rng(20170101);
+  const auto tableLimit = static_cast<std::uint64_t>(primes.back());
+  std::vector<std::uint32_t> inTable(1'000'000);
+  std::vector<std::uint32_t> any32(1'000'000);
+  std::vector<std::uint64_t> any64(1'000'000);
+  for (std::size_t i = 0; i < inTable.size(); ++i)
   {
-    printFactors(num);
-    std::cout << "--------------------------" << std::endl;
-    printFactors(den);
-    std::cout << std::endl;
+    inTable[i] = static_cast<std::uint32_t>(rng() % tableLimit) | 1u;
+    any32[i] = static_cast<std::uint32_t>(rng()) | 1u;
+    any64[i] = rng() | 1u;
   }
 
-  // after removing common numbers, recalculate denominator and numerator
-  const auto t = calculateProduct(num);
-  const auto n = calculateProduct(den);
+  // the table only answers for numbers below its last prime, isPrime<std::uint32_t> covers all 32-bit
+  measure("prime table binary search, n < 10^6", inTable, [&](std::uint32_t x) {
+    return std::binary_search(primes.begin(), primes.end(), static_cast<long long>(x));
+  });
+  measure("hashed Miller-Rabin, n < 10^6", inTable, [](std::uint32_t x) { return isPrime(x); });
+  measure("hashed Miller-Rabin, n < 2^32", any32, [](std::uint32_t x) { return isPrime(x); });
+  measure("7-base Miller-Rabin, n < 2^64", any64, [](std::uint64_t x) { return isPrime(x); });
+  measure("next prime, n < 2^32", any32, [&](std::uint32_t x) { return nextPrime(x, primes).has_value(); });
+  measure("next prime, n < 2^64", any64, [&](std::uint64_t x) { return nextPrime(x, primes).has_value(); });
+  measure("previous prime, n < 2^64", any64, [&](std::uint64_t x) { return prevPrime(x, primes).has_value(); });
 
-  if (output)
-  {
-    if (t > n)
-    {
-      // 9/4
-      // 9/4 = 2
-      // 9 - 2*4 = 1
-      // 2 1/4
-      std::cout << number << " = " << t << "/" << n << " ==> " << (t / n) << " " << (t - (t / n) * n) << "/"
-                << n << std::endl;
-    }
-    else
+  // Baillie-PSW throughput per width, random odd numbers are mostly rejected by trial division or
+  // the base 2 test while primes pay for both the Miller-Rabin and the Lucas part
+  const auto randomOdd = [&](std::size_t bits) {
+    BigInt x;
+    for (std::size_t i = 0; i < bits / 32; ++i)
     {
-      std::cout << number << " = " << t << "/" << n << std::endl;
+      x = (x << 32) + BigInt(static_cast<std::uint32_t>(rng()));
     }
-  }
-  return std::make_pair(t, n);
-}
-
-//////////////////////////////////////////////////////////////////
-
-std::map<long long, long long> factorizeNumber(const std::string& number, const std::vector<long long>& primes, const bool output)
-{
-  const auto m = std::stoll(number);
-
-  if (output)
-  {
-    std::cout << std::endl << std::setw(10) << m << " = ";
-  }
-
-  auto factors = divideWithPrimes(m, primes);
-  std::map<long long, long long> factorsWithExp;
-  for (auto i : factors)
+    x += BigInt(1) << (bits - 1);
+    return x.isOdd() ? x : x + BigInt(1);
+  };
+  for (std::size_t bits : {128u, 256u, 512u, 1024u})
   {
-    auto it = factorsWithExp.find(i);
-    if (it != factorsWithExp.end())
+    std::vector<BigInt> odd(1000);
+    std::vector<BigInt> wide;
+    for (auto& x : odd)
     {
-      factorsWithExp[i]++;
+      x = randomOdd(bits);
     }
-    else
+    while (wide.size() < 50)
     {
-      factorsWithExp[i] = 1;
+      if (auto x = randomOdd(bits); isProbablePrime(x))
+      {
+        wide.push_back(x);
+      }
     }
+    measure(fmt::format("Baillie-PSW, random odd {} bits", bits).c_str(), odd, isProbablePrime);
+    measure(fmt::format("Baillie-PSW, primes {} bits", bits).c_str(), wide, isProbablePrime);
   }
 
-  if (output)
+  // the two segmented sieves counting primes, --count with --sieve=atkin for larger limits
+  for (std::uint64_t limit = 1'000'000; limit <= 1'000'000'000; limit *= 10)
   {
-    auto count = 0; // number of factors printed
-    for (auto n : factorsWithExp)
+    for (const auto atkin : {false, true})
     {
-      if (count++ > 0)
-      {
-        fmt::print(fg(fmt::color::gray), "*");
-      }
-
-      if (n.second != 1)
+      std::uint64_t count = 0;
+      const auto start = steady_clock::now();
+      if (atkin)
       {
-        fmt::print(fg(fmt::color::white),"{}", n.first);
-        fmt::print(fg(fmt::color::red),"^");
-        fmt::print(fg(fmt::color::yellow),"{}", n.second);
+        atkinPrimes(2, limit + 1, [&](std::uint64_t) { ++count; }, [](std::uint64_t) {});
       }
       else
       {
-        fmt::print(fg(fmt::color::white),"{}", n.first);
+        sievePrimes(2, limit + 1, [&](std::uint64_t) { ++count; });
       }
+      const auto ms = static_cast<double>(duration_cast<microseconds>(steady_clock::now() - start).count()) / 1000;
+      fmt::print(
+        "{:<45} {:8.1f} ms       ({} primes)\n",
+        fmt::format("{} count to {}", atkin ? "Atkin" : "Eratosthenes", limit),
+        ms,
+        count);
     }
-
-    std::cout << std::endl;
   }
-
-  return factorsWithExp;
 }
 
 /**
@@ -524,8 +7892,168 @@ bool verifyFunctionality()
     return false;
   }
 
+  auto result2000006 = divideWithPrimes(2000006, primes);
+  if (result2000006.size() != 2 || result2000006.back() != 1000003)
+  {
+    std::cerr << "Invalid factors 2000006" << std::endl;
+    return false;
+  }
+  if (!isPrime(4294967291u) || isPrime(3215031751u) || !isPrime(18446744073709551557ull)
+      || isPrime(3825123056546413051ull))
+  {
+    std::cerr << "Invalid primality test" << std::endl;
+    return false;
+  }
+  // 2^127-1 is prime, 2^128+1 = 59649589127497217 * 5704689200685129054721
+  const auto mersenne = (BigInt(1) << 127) - BigInt(1);
+  const auto fermat = (BigInt(1) << 128) + BigInt(1);
+  if (!isProbablePrime(mersenne) || isProbablePrime(fermat) || fermat % BigInt(59649589127497217ull) != BigInt()
+      || BigInt::fromString(mersenne.toString()) != mersenne)
+  {
+    std::cerr << "Invalid wide primality test" << std::endl;
+    return false;
+  }
+  const auto tree = productTree({BigInt(15), BigInt(77), BigInt(221), BigInt(35)});
+  const auto remainders = remainderTree(tree.back().front(), tree, true);
+  if (gcd(BigInt(15), remainders[0] / BigInt(15)) != BigInt(5)
+      || gcd(BigInt(221), remainders[2] / BigInt(221)) != BigInt(1))
+  {
+    std::cerr << "Invalid batch gcd" << std::endl;
+    return false;
+  }
+  if (remainderTree(BigInt(210), productTree({BigInt(12), BigInt(35), BigInt(97)}), false)
+      != std::vector<BigInt>{BigInt(6), BigInt(0), BigInt(16)})
+  {
+    std::cerr << "Invalid remainder tree" << std::endl;
+    return false;
+  }
+  auto sieved = 0;
+  sievePrimes(1000000, 2000000, [&](std::uint64_t) { ++sieved; });
+  atkinPrimes(1000000, 2000000, [&](std::uint64_t) { ++sieved; }, [](std::uint64_t) {});
+  if (sieved != 2 * 70435)
+  {
+    std::cerr << "Invalid segmented sieve" << std::endl;
+    return false;
+  }
+  std::map<std::uint64_t, std::uint64_t> exponents;
+  factorialExponents(10, primes, [&](std::uint64_t p, std::uint64_t e) { exponents[p] = e; });
+  if (exponents != std::map<std::uint64_t, std::uint64_t>{{2, 8}, {3, 4}, {5, 2}, {7, 1}})
+  {
+    std::cerr << "Invalid factorial" << std::endl;
+    return false;
+  }
+  exponents.clear();
+  binomialExponents(10, 3, {2, 3, 5}, [&](std::uint64_t p, std::uint64_t e) { exponents[p] = e; }); // 7 from the sieve
+  if (exponents != std::map<std::uint64_t, std::uint64_t>{{2, 3}, {3, 1}, {5, 1}})
+  {
+    std::cerr << "Invalid binomial" << std::endl;
+    return false;
+  }
+  for (const auto& engine : sieveEngines())
+  {
+    if (engine.generate(100'000) != segmentedSieve(100'000))
+    {
+      std::cerr << "Invalid " << engine.name << " sieve" << std::endl;
+      return false;
+    }
+  }
+  std::uint64_t previous = 0;
+  for (unsigned i = 1; i <= 4; ++i)
+  {
+    const auto [begin, end] = shardRange(0, 1000000000001, i, 4, false);
+    if (begin != previous || (i > 1 && (begin - 3) % (2 * sieveSegmentSize) != 0) || (i == 4 && end != 1000000000001))
+    {
+      std::cerr << "Invalid shard " << i << "/4" << std::endl;
+      return false;
+    }
+    previous = end;
+  }
+  // the last segments before 2^64
+  const auto top = std::numeric_limits<std::uint64_t>::max();
+  std::uint64_t topCount = 0;
+  std::uint64_t topSum = 0;
+  sievePrimes(top - 1099999, top, [&](std::uint64_t p) {
+    ++topCount;
+    topSum += p;
+  });
+  if (topCount != 24759 || topSum != 18446744060035937337ull)
+  {
+    std::cerr << "Invalid sieve below 2^64" << std::endl;
+    return false;
+  }
+  if (nextPrime(4294967291u, primes) != 4294967311u || prevPrime(65537u, primes) != 65521u
+      || prevPrime(BigInt(1) << 64, primes) != BigInt(18446744073709551557ull)
+      || nextPrime(BigInt(1) << 64, primes) != (BigInt(1) << 64) + BigInt(13))
+  {
+    std::cerr << "Invalid next or previous prime" << std::endl;
+    return false;
+  }
+  std::vector<std::uint64_t> roots;
+  primitiveRoots(2, 42, [&](std::uint64_t, std::uint64_t g) { roots.push_back(g); });
+  if (roots != std::vector<std::uint64_t>{1, 2, 2, 3, 2, 2, 3, 2, 5, 2, 3, 2, 6} || primitiveRoot(1000000007, primes) != 5
+      || order(2, 1000000007, primes) != 500000003 || order(3, 1 << 10, primes) != 256 || order(10, 49, primes) != 42)
+  {
+    std::cerr << "Invalid primitive root or order" << std::endl;
+    return false;
+  }
+  if (aliquotSum(220, primes) != 284 || aliquotSum(1, primes) != 0 || aliquotSum(6917529027641081856, primes))
+  {
+    std::cerr << "Invalid aliquot sum" << std::endl;
+    return false;
+  }
+  if (primeCount(1000, "", false) != 168 || primeCount(1000000007, "", false) != 50847535
+      || primeCount(4294967311, "", false) != 203280222)
+  {
+    std::cerr << "Invalid prime count" << std::endl;
+    return false;
+  }
+  const ModRing ring(3ull << 40);
+  if (primePowerSum(1000000, 1, WrapRing{}).lo != 37550402023
+      || ring.toInteger(primePowerSum(100000, 3, ring)) != 2676935636671)
+  {
+    std::cerr << "Invalid prime sum" << std::endl;
+    return false;
+  }
+  std::vector<std::uint64_t> exported;
+  std::vector<std::uint64_t> decompressed;
+  sievePrimes(0, 200000, [&](std::uint64_t p) { exported.push_back(p); });
+  sievePrimes(1ull << 40, (1ull << 40) + 100000, [&](std::uint64_t p) { exported.push_back(p); });
+  for (const auto low : {0ull, 1ull << 40})
+  {
+    const auto high = low + (low == 0 ? 200000 : 100000);
+    const auto block = compressBlock(low, high, sieveBase(high, high - low));
+    decompressBlock(block.first, block.count, block.code, [&](std::uint64_t p) { decompressed.push_back(p); });
+  }
+  if (decompressed != exported)
+  {
+    std::cerr << "Invalid prime export" << std::endl;
+    return false;
+  }
+  std::vector<std::pair<std::uint64_t, std::uint32_t>> sorted{{300, 0}, {5, 1}, {1ull << 40, 2}, {300, 3}};
+  radixSort(sorted);
+  if (sorted != std::vector<std::pair<std::uint64_t, std::uint32_t>>{{5, 1}, {300, 0}, {300, 3}, {1ull << 40, 2}})
+  {
+    std::cerr << "Invalid radix sort" << std::endl;
+    return false;
+  }
+  const std::string line = " +00001234567890123456789\r";
+  if (parseBatchLine(line.data(), line.data() + line.size()) != 1234567890123456789
+      || parseBatchLine(line.data(), line.data() + 1))
+  {
+    std::cerr << "Invalid batch line parsing" << std::endl;
+    return false;
+  }
+  auto partial = startFactorization(9223371996052586513, primes); // (2^31-1) * 4294967279
+  if (continueFactorization(partial, FactorBudget{1}) || partial.composites.size() != 1
+      || !continueFactorization(partial, FactorBudget{})
+      || partial.factors != std::map<long long, long long>{{2147483647, 1}, {4294967279, 1}})
+  {
+    std::cerr << "Invalid resumed factorization" << std::endl;
+    return false;
+  }
+
   const bool output = false;
-  const auto&& [t, n] = decimalToFraction(std::string("0.12"), primes, output);
+  const auto&& [t, n] = decimalToFraction(std::string("0.12"), output);
   if (t != 3)
   {
     std::cerr << "Invalid denominator" << std::endl;
@@ -536,6 +8064,19 @@ bool verifyFunctionality()
     std::cerr << "Invalid numerator" << std::endl;
     return false;
   }
+  if (doubleToFraction(0.1).denominator != BigInt(1) << 55
+      || approximateDouble(3.141592653589793, 1000) != std::make_pair(355LL, 113LL)
+      || approximateDouble(-0.1, 1000) != std::make_pair(-1LL, 10LL) || approximateDouble(1e300, 1000))
+  {
+    std::cerr << "Invalid double to fraction" << std::endl;
+    return false;
+  }
+  if (decimalToFraction(std::string(".99999375"), output) != std::make_pair(159999LL, 160000LL)
+      || decimalToFraction(std::string("0.0"), output) != std::make_pair(0LL, 1LL))
+  {
+    std::cerr << "Invalid decimal reduction" << std::endl;
+    return false;
+  }
 
   auto m = factorizeNumber(std::string("13112"), primes, output);
   if (m[2] != 3 || m[11] != 1 || m[149] != 1)
@@ -543,5 +8084,12 @@ bool verifyFunctionality()
     std::cerr << "factorizing failed" << std::endl;
   }
 
+  if (perfectPower(std::uint64_t{1} << 62) != std::make_pair(std::uint64_t{2}, 62u) || perfectPower(std::uint64_t{1000003} * 1000003 * 1000003).second != 3
+      || factorizeNumber(std::string("1000009000027000027"), primes, output)[1000003] != 3)
+  {
+    std::cerr << "perfect power failed" << std::endl;
+    return false;
+  }
+
   return true;
 }